@@ -30,10 +30,21 @@ Options parseCmdLine(std::span<const char* const> args)
     if (args.size() >= 2) {
         result.bind_address = args[1];
     }
+    if (args.size() >= 3) {
+        std::string_view job_threads_string(args[2]);
+        unsigned int job_threads{};
+        auto [ptr, ec] = std::from_chars(job_threads_string.data(), job_threads_string.data() + job_threads_string.size(), job_threads);
+        if (ptr != job_threads_string.data() + job_threads_string.size()) {
+            GC_ERROR("Failed to parse job threads cmd line argument");
+        }
+        else {
+            result.job_threads = job_threads;
+        }
+    }
     return result;
 }
 
-// Command line: ./dedicated_server [port [address]]
+// Command line: ./dedicated_server [port [address [job_threads]]]
 int main(int argc, char* argv[])
 {
 
@@ -44,6 +55,7 @@ int main(int argc, char* argv[])
     init_options.author = "bailwillharr";
     init_options.version = "v0.0.0";
     init_options.headless = true;
+    init_options.job_threads = options.job_threads;
 
     gc::App::initialise(init_options);
 
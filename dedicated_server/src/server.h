@@ -10,6 +10,7 @@ class App; // forward-dec
 struct Options {
     std::string bind_address{};
     uint16_t bind_port{};
+    unsigned int job_threads{}; // 0 lets App decide
 };
 
 void buildAndStartServer(gc::App& app, Options options);
\ No newline at end of file
@@ -31,6 +31,12 @@ struct AppInitOptions {
     std::string version;
     std::vector<std::string> pak_files_override;
     bool headless = false;
+    // 0 uses one worker per physical core, minus one for the main thread.
+    // Set this when several instances share a machine, e.g. dedicated servers.
+    unsigned int job_threads = 0;
+    // Pins the main thread and the job workers to their own cores (Linux only).
+    // Restrict the CPUs of each instance with taskset or a cpuset too, otherwise every instance pins to the same cores.
+    bool pin_threads = false;
 };
 
 class App {
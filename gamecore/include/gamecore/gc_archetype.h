@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "gamecore/gc_ecs.h"
+
+namespace gc {
+
+constexpr uint32_t ARCHETYPE_NONE = std::numeric_limits<uint32_t>::max();
+
+// Passed to the Archetype constructor for each component that uses ComponentArrayType::ARCHETYPE storage
+struct ArchetypeColumnInfo {
+    uint32_t component_index;
+    uint32_t component_size;
+};
+
+/*
+ * An Archetype is a table containing every entity that has exactly the same Signature.
+ * Each entity occupies one row. Components registered with ComponentArrayType::ARCHETYPE get a column in the table,
+ * so all of those components are tightly packed for every entity in the archetype.
+ * Components using SPARSE or DENSE storage still live in their ComponentArray, the archetype only records which entities have them.
+ * Rows are swap-removed so the table never has holes.
+ * Since components are trivially copyable, columns are stored as raw bytes and moved between archetypes with memcpy.
+ * Each column also stores the World change tick of every row (see World::forEachChanged()), which moves along with the component.
+ */
+class Archetype {
+    struct Column {
+        uint32_t component_index;
+        uint32_t component_size;
+        std::vector<std::byte> data;
+        std::vector<uint32_t> change_ticks; // one per row
+        uint32_t max_change_tick;
+    };
+
+    static constexpr uint8_t NO_COLUMN = std::numeric_limits<uint8_t>::max();
+
+    Signature m_signature;
+    std::vector<Entity> m_entities{};
+    std::vector<Column> m_columns{};
+    std::array<uint8_t, MAX_COMPONENTS> m_column_lookup{}; // component index -> index into m_columns
+
+    // cached archetype transitions when a component is added/removed
+    std::array<uint32_t, MAX_COMPONENTS> m_add_edges{};
+    std::array<uint32_t, MAX_COMPONENTS> m_remove_edges{};
+
+public:
+    Archetype(const Signature& signature, std::span<const ArchetypeColumnInfo> columns);
+    Archetype(const Archetype&) = delete;
+
+    Archetype& operator=(const Archetype&) = delete;
+
+    const Signature& getSignature() const { return m_signature; }
+
+    uint32_t getEntityCount() const { return static_cast<uint32_t>(m_entities.size()); }
+
+    std::span<const Entity> getEntities() const { return m_entities; }
+
+    bool hasColumn(uint32_t component_index) const
+    {
+        GC_ASSERT(component_index < MAX_COMPONENTS);
+        return m_column_lookup[component_index] != NO_COLUMN;
+    }
+
+    // Returns a pointer to the first element of the column. Invalidated by any row insertion or removal.
+    std::byte* getColumnData(uint32_t component_index)
+    {
+        GC_ASSERT(hasColumn(component_index));
+        return m_columns[m_column_lookup[component_index]].data.data();
+    }
+
+    template <ValidComponent T>
+    std::span<T> getColumn()
+    {
+        const uint32_t component_index = getComponentIndex<T>();
+        GC_ASSERT(hasColumn(component_index));
+        GC_ASSERT(m_columns[m_column_lookup[component_index]].component_size == sizeof(T));
+        return std::span<T>(reinterpret_cast<T*>(getColumnData(component_index)), m_entities.size());
+    }
+
+    void* getComponentData(uint32_t component_index, uint32_t row)
+    {
+        GC_ASSERT(row < m_entities.size());
+        const Column& column = m_columns[m_column_lookup[component_index]];
+        return getColumnData(component_index) + static_cast<std::size_t>(row) * column.component_size;
+    }
+
+    // Writing different rows from different threads is fine
+    std::span<uint32_t> getChangeTicks(uint32_t component_index)
+    {
+        GC_ASSERT(hasColumn(component_index));
+        return m_columns[m_column_lookup[component_index]].change_ticks;
+    }
+
+    void setChangeTick(uint32_t component_index, uint32_t row, uint32_t tick)
+    {
+        GC_ASSERT(row < m_entities.size());
+        getChangeTicks(component_index)[row] = tick;
+    }
+
+    // Highest change tick in the column, allows skipping the column when nothing has changed.
+    // Must be set whenever a row's tick is set, from the thread that owns the World.
+    uint32_t getMaxChangeTick(uint32_t component_index) const
+    {
+        GC_ASSERT(hasColumn(component_index));
+        return m_columns[m_column_lookup[component_index]].max_change_tick;
+    }
+
+    void setMaxChangeTick(uint32_t component_index, uint32_t tick)
+    {
+        GC_ASSERT(hasColumn(component_index));
+        m_columns[m_column_lookup[component_index]].max_change_tick = tick;
+    }
+
+    void setAllChangeTicks(uint32_t component_index, uint32_t tick)
+    {
+        std::ranges::fill(getChangeTicks(component_index), tick);
+        setMaxChangeTick(component_index, tick);
+    }
+
+    uint32_t getAddEdge(uint32_t component_index) const { return m_add_edges[component_index]; }
+    uint32_t getRemoveEdge(uint32_t component_index) const { return m_remove_edges[component_index]; }
+    void setAddEdge(uint32_t component_index, uint32_t archetype) { m_add_edges[component_index] = archetype; }
+    void setRemoveEdge(uint32_t component_index, uint32_t archetype) { m_remove_edges[component_index] = archetype; }
+
+    // Reserves space for this many more rows
+    void reserve(uint32_t additional_rows);
+
+    // Appends a row with zero-initialised column data and change ticks. Returns the new row index.
+    uint32_t addRow(Entity entity);
+
+    // Swap-removes a row. Returns the entity that was moved into 'row' or ENTITY_NONE if 'row' was the last row.
+    Entity removeRow(uint32_t row);
+
+    // Appends the row to 'destination', copying over columns that both archetypes share, then removes it from this archetype.
+    // Returns the row index in 'destination'. 'moved_entity' is set as in removeRow().
+    uint32_t moveRow(uint32_t row, Archetype& destination, Entity& moved_entity);
+};
+
+} // namespace gc
@@ -17,8 +17,11 @@ class CameraSystem : public System {
 public:
     static constexpr auto NAME = Name::createConstexpr("CameraSystem");
 
+private:
+    Query<const TransformComponent, const CameraComponent> m_cameras;
+
 public:
-    CameraSystem(World& world) : System(world) {}
+    CameraSystem(World& world) : System(world), m_cameras(world.query<const TransformComponent, const CameraComponent>()) {}
 
     void onUpdate(FrameState& frame_state) override
     {
@@ -28,7 +31,7 @@ public:
 
         const float aspect_ratio =
             static_cast<float>(frame_state.window_state->getWindowSize().x) / static_cast<float>(frame_state.window_state->getWindowSize().y);
-        m_world.forEach<TransformComponent, CameraComponent>([&]([[maybe_unused]] Entity entity, const TransformComponent& t, const CameraComponent& c) {
+        m_cameras.forEach([&]([[maybe_unused]] Entity entity, const TransformComponent& t, const CameraComponent& c) {
             if (c.m_active) {
                 // in view space
                 glm::mat4 projection_matrix = glm::infinitePerspectiveRH_NO(c.m_fov_radians, aspect_ratio, c.m_near);
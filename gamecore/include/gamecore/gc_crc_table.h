@@ -8,6 +8,7 @@
 #include <cstdint>
 
 #include <array>
+#include <string_view>
 
 #ifdef GC_CHECK_COLLISIONS
 #include <mutex>
@@ -59,6 +60,16 @@ inline constexpr uint32_t crc32_impl(const char* const str)
     return crc ^ 0xffffffff;
 }
 
+// Same hash as above for strings without a null terminator, such as substrings of a path
+inline constexpr uint32_t crc32_impl(const std::string_view str)
+{
+    uint32_t crc = 0xffffffffu;
+    for (const char c : str) {
+        crc = (crc >> 8) ^ crc_table[(crc ^ c) & 0xff];
+    }
+    return crc ^ 0xffffffff;
+}
+
 #ifdef GC_CHECK_COLLISIONS
 
 struct Crc32GlobalMap {
@@ -84,7 +95,7 @@ struct Crc32ThreadLocalMap {
     ~Crc32ThreadLocalMap() { crc32FlushMapAndCheckCollisions(local_map); }
 };
 
-inline uint32_t crc32(const char* const id)
+inline uint32_t crc32(const std::string_view id)
 {
     constexpr size_t THREAD_LOCAL_MAP_FLUSH_SIZE = 1024; // flushes to global map once it reaches this size
 
@@ -110,12 +121,14 @@ inline uint32_t crc32(const char* const id)
     return hash;
 }
 
-inline uint32_t crc32(const std::string& id) { return crc32(id.c_str()); }
+inline uint32_t crc32(const char* const id) { return crc32(std::string_view(id)); }
+inline uint32_t crc32(const std::string& id) { return crc32(std::string_view(id)); }
 
 #else
 
 inline constexpr uint32_t crc32(const char* const id) { return crc32_impl(id); }
 inline constexpr uint32_t crc32(const std::string& id) { return crc32(id.c_str()); }
+inline constexpr uint32_t crc32(const std::string_view id) { return crc32_impl(id); }
 
 #endif
 
@@ -2,13 +2,17 @@
 
 #include <cstdint>
 
+#include <algorithm>
+#include <array>
 #include <bitset>
 #include <vector>
 #include <limits>
-#include <unordered_map>
+#include <memory>
+#include <span>
 #include <atomic>
 
 #include "gamecore/gc_assert.h"
+#include "gamecore/gc_name.h"
 #include "gclog/gclog.h"
 
 namespace gc {
@@ -34,12 +38,18 @@ extern std::atomic<uint32_t> g_next_system_index;
 extern std::atomic<uint32_t> g_next_frame_state_object_index;
 
 // Produces a unique integer for a given type that can be used as an array index.
+// const T gives the same index as T. World iteration functions use const to mean the component is only read.
 template <ValidComponent T>
 uint32_t getComponentIndex()
 {
-    static uint32_t index = g_next_component_index.fetch_add(1, std::memory_order_relaxed);
-    GC_ASSERT(index < MAX_COMPONENTS);
-    return index;
+    if constexpr (std::is_const_v<T>) {
+        return getComponentIndex<std::remove_const_t<T>>();
+    }
+    else {
+        static uint32_t index = g_next_component_index.fetch_add(1, std::memory_order_relaxed);
+        GC_ASSERT(index < MAX_COMPONENTS);
+        return index;
+    }
 }
 
 template <ValidDerivedSystem T>
@@ -86,6 +96,16 @@ public:
 
     uint32_t componentCount() const { return static_cast<uint32_t>(m_bits.count()); }
 
+    // true if every component in 'other' is also in this signature
+    bool contains(const Signature& other) const { return (m_bits & other.m_bits) == other.m_bits; }
+
+    // true if any component is in both signatures
+    bool intersects(const Signature& other) const { return (m_bits & other.m_bits).any(); }
+
+    std::size_t hash() const { return std::hash<std::bitset<MAX_COMPONENTS>>{}(m_bits); }
+
+    bool operator==(const Signature& other) const { return m_bits == other.m_bits; }
+
     template <typename... Ts>
     static Signature fromTypes()
     {
@@ -95,57 +115,134 @@ public:
     }
 };
 
+/*
+ * Declares what a System touches so World::update() can run it at the same time as other systems.
+ * Two systems conflict if one writes a component the other reads or writes, or if they share an exclusive resource.
+ * Conflicting systems always run in registration order, others may run concurrently on the job system.
+ * Resources are arbitrary Names for anything that isn't a component, such as parts of FrameState.
+ * A system that runs concurrently must not create/delete entities or add/remove components.
+ */
+class SystemAccess {
+    Signature m_reads{};
+    Signature m_writes{};
+    std::vector<Name> m_exclusive_resources{};
+    bool m_main_thread{};
+
+public:
+    template <typename... Ts>
+    SystemAccess& reads()
+    {
+        (m_reads.set<Ts>(), ...);
+        return *this;
+    }
+
+    template <typename... Ts>
+    SystemAccess& writes()
+    {
+        (m_writes.set<Ts>(), ...);
+        return *this;
+    }
+
+    SystemAccess& exclusive(Name resource)
+    {
+        m_exclusive_resources.push_back(resource);
+        return *this;
+    }
+
+    // The system may still run alongside others but always on the thread that calls World::update()
+    SystemAccess& onMainThread()
+    {
+        m_main_thread = true;
+        return *this;
+    }
+
+    bool isMainThread() const { return m_main_thread; }
+
+    bool conflictsWith(const SystemAccess& other) const;
+};
+
 class IComponentArray {
 public:
+    // Change ticks are also tracked per block of this many elements, see ComponentArray::getBlockChangeTicks()
+    static constexpr uint32_t CHANGE_TICK_BLOCK_SIZE = 64;
+
     virtual ~IComponentArray() = default;
 
     virtual void addComponent(Entity entity) = 0;
     virtual void removeComponent(Entity entity) = 0;
+
+    // Grows storage so 'count' more components can be added, for entities up to and including 'highest_entity', without reallocating
+    virtual void reserve(uint32_t count, Entity highest_entity) = 0;
 };
 
 /*
  * Dense ComponentArrays should be used when a majority of entities have the component.
  * Sparse ComponentArrays should be used otherwise, especially if the component is very large.
+ * Archetype storage doesn't use a ComponentArray at all. The component is stored in a column of each Archetype (see gc_archetype.h),
+ * so it is packed together with the other components of entities with the same Signature. Use it for components that are iterated
+ * over in bulk, adding/removing them is more expensive as the entity's other archetype components have to be moved.
  * The methods in this class don't actually check if an entity should have a component.
  * This class is just a storage backend while the World actually manages components.
  */
-enum class ComponentArrayType { SPARSE, DENSE };
+enum class ComponentArrayType { SPARSE, DENSE, ARCHETYPE };
 
+/*
+ * Sparse ComponentArrays are sparse sets:
+ * m_component_array is kept packed (no holes) and m_dense_entities holds the entity owning each element.
+ * m_sparse_pages maps an entity to its index in m_component_array. Pages are allocated on demand so large entity IDs
+ * don't require a huge allocation up front. Removal swaps the last element into the removed slot.
+ * A lookup is one load from the page table, one load from the page and then the component itself.
+ */
 template <ValidComponent T, ComponentArrayType ArrayType>
 class ComponentArray : public IComponentArray {
-    std::vector<T> m_component_array{}; // looked up via entity if dense (since Entity is just an integer), looked up via m_entity_component_indices if sparse
-    std::unordered_map<Entity, uint32_t> m_entity_component_indices{}; // only used if sparse
-    std::vector<uint32_t> m_free_indices{};                             // only used if sparse
+    static_assert(ArrayType != ComponentArrayType::ARCHETYPE, "Archetype components are stored by the World in Archetype tables");
+
+    static constexpr uint32_t SPARSE_PAGE_SIZE = 4096;
+    static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+    using SparsePage = std::array<uint32_t, SPARSE_PAGE_SIZE>;
+
+    std::vector<T> m_component_array{}; // looked up via entity if dense (since Entity is just an integer), looked up via m_sparse_pages if sparse
+    std::vector<Entity> m_dense_entities{};                   // only used if sparse
+    std::vector<std::unique_ptr<SparsePage>> m_sparse_pages{}; // only used if sparse
+
+    // World change tick when each component was last accessed mutably. Same indexing as m_component_array.
+    std::vector<uint32_t> m_change_ticks{};
+    std::vector<uint32_t> m_block_change_ticks{}; // highest tick in each CHANGE_TICK_BLOCK_SIZE elements of m_change_ticks
+    uint32_t m_max_change_tick{};
 
 public:
     void addComponent(const Entity entity) override
     {
         GC_ASSERT(entity != ENTITY_NONE);
 
-        uint32_t index{};
         if constexpr (ArrayType == ComponentArrayType::SPARSE) {
-            GC_ASSERT(!m_entity_component_indices.contains(entity));
-            if (m_free_indices.empty()) {
-                m_entity_component_indices.insert({entity, static_cast<uint32_t>(m_component_array.size())});
-                index = static_cast<uint32_t>(m_component_array.size());
-                m_component_array.resize(index + 1);
+            const uint32_t page_index = entity / SPARSE_PAGE_SIZE;
+            if (page_index >= m_sparse_pages.size()) {
+                m_sparse_pages.resize(page_index + 1);
             }
-            else {
-                // can reuse a slot in m_component_array
-                index = m_free_indices.back();
-                m_free_indices.pop_back();
-                GC_ASSERT(index < m_component_array.size());
-                m_entity_component_indices.insert({entity, index});
-                m_component_array[index] = T{};
+            if (!m_sparse_pages[page_index]) {
+                m_sparse_pages[page_index] = std::make_unique<SparsePage>();
+                m_sparse_pages[page_index]->fill(INVALID_INDEX);
             }
+            uint32_t& index = (*m_sparse_pages[page_index])[entity % SPARSE_PAGE_SIZE];
+            GC_ASSERT(index == INVALID_INDEX);
+            index = static_cast<uint32_t>(m_component_array.size());
+            m_component_array.emplace_back();
+            m_dense_entities.push_back(entity);
+            m_change_ticks.push_back(0);
+            resizeBlockChangeTicks();
         }
         else { // ComponentArrayType::DENSE
-            index = entity;
+            const uint32_t index = entity;
             if (index >= m_component_array.size()) {
                 m_component_array.resize(index + 1);
+                m_change_ticks.resize(index + 1);
+                resizeBlockChangeTicks();
             }
             else {
                 m_component_array[index] = T{};
+                m_change_ticks[index] = 0;
             }
         }
     }
@@ -155,9 +252,22 @@ public:
         GC_ASSERT(entity != ENTITY_NONE);
 
         if constexpr (ArrayType == ComponentArrayType::SPARSE) {
-            if (auto it = m_entity_component_indices.find(entity); it != m_entity_component_indices.end()) {
-                m_free_indices.push_back(it->second);
-                m_entity_component_indices.erase(it);
+            const uint32_t index = findSparseIndex(entity);
+            if (index != INVALID_INDEX) {
+                const auto last_index = static_cast<uint32_t>(m_component_array.size() - 1);
+                if (index != last_index) {
+                    const Entity moved_entity = m_dense_entities[last_index];
+                    m_component_array[index] = m_component_array[last_index];
+                    m_dense_entities[index] = moved_entity;
+                    m_change_ticks[index] = m_change_ticks[last_index];
+                    uint32_t& block_tick = m_block_change_ticks[index / CHANGE_TICK_BLOCK_SIZE];
+                    block_tick = std::max(block_tick, m_change_ticks[index]);
+                    (*m_sparse_pages[moved_entity / SPARSE_PAGE_SIZE])[moved_entity % SPARSE_PAGE_SIZE] = index;
+                }
+                m_component_array.pop_back();
+                m_dense_entities.pop_back();
+                m_change_ticks.pop_back();
+                (*m_sparse_pages[entity / SPARSE_PAGE_SIZE])[entity % SPARSE_PAGE_SIZE] = INVALID_INDEX;
             }
             else {
                 GC_TRACE("ComponentArray::removeComponent() called on entity {} that wasn't in sparse ComponentArray {} (id: {})", entity, typeid(T).name(),
@@ -169,21 +279,104 @@ public:
         }
     }
 
-    // These references can be invalidated if addComponent() is called after
-    T& get(const Entity entity)
+    void reserve(const uint32_t count, const Entity highest_entity) override
+    {
+        GC_ASSERT(highest_entity != ENTITY_NONE);
+
+        if constexpr (ArrayType == ComponentArrayType::SPARSE) {
+            m_component_array.reserve(m_component_array.size() + count);
+            m_dense_entities.reserve(m_dense_entities.size() + count);
+            m_change_ticks.reserve(m_change_ticks.size() + count);
+            m_block_change_ticks.reserve((m_change_ticks.size() + count) / CHANGE_TICK_BLOCK_SIZE + 1);
+            if (highest_entity / SPARSE_PAGE_SIZE >= m_sparse_pages.size()) {
+                m_sparse_pages.resize(highest_entity / SPARSE_PAGE_SIZE + 1);
+            }
+        }
+        else { // ComponentArrayType::DENSE
+            m_component_array.reserve(static_cast<std::size_t>(highest_entity) + 1);
+            m_change_ticks.reserve(static_cast<std::size_t>(highest_entity) + 1);
+            m_block_change_ticks.reserve(static_cast<std::size_t>(highest_entity) / CHANGE_TICK_BLOCK_SIZE + 1);
+        }
+    }
+
+    // These references can be invalidated if addComponent() is called after.
+    // For sparse arrays, they can also be invalidated by removeComponent() as the last element is moved into the removed slot.
+    T& get(const Entity entity) { return m_component_array[getIndex(entity)]; }
+
+    // Change ticks are set by the World. Different entities can be set concurrently as long as they all use the same tick.
+    void setChangeTick(const Entity entity, const uint32_t tick)
+    {
+        const uint32_t index = getIndex(entity);
+        m_change_ticks[index] = tick;
+        // ticks only ever increase so this is always the block's highest, but other threads may be storing it too
+        std::atomic_ref<uint32_t>(m_block_change_ticks[index / CHANGE_TICK_BLOCK_SIZE]).store(tick, std::memory_order_relaxed);
+    }
+
+    // Every setChangeTick() must be accompanied by a call to this from the thread that owns the World
+    void setMaxChangeTick(const uint32_t tick) { m_max_change_tick = tick; }
+
+    void setAllChangeTicks(const uint32_t tick)
+    {
+        std::fill(m_change_ticks.begin(), m_change_ticks.end(), tick);
+        std::fill(m_block_change_ticks.begin(), m_block_change_ticks.end(), tick);
+        m_max_change_tick = tick;
+    }
+
+    // Highest tick of any component in the array, allows skipping the array when nothing has changed
+    uint32_t getMaxChangeTick() const { return m_max_change_tick; }
+
+    // Indexed by entity if dense. Parallel to getComponents() if sparse.
+    std::span<const uint32_t> getChangeTicks() const { return m_change_ticks; }
+
+    // Highest tick of each CHANGE_TICK_BLOCK_SIZE elements of getChangeTicks(), so unchanged blocks can be skipped.
+    // May have more elements than needed to cover getChangeTicks().
+    std::span<const uint32_t> getBlockChangeTicks() const { return m_block_change_ticks; }
+
+    // Every component in the sparse set, packed. getEntities()[i] owns getComponents()[i].
+    std::span<T> getComponents()
+        requires(ArrayType == ComponentArrayType::SPARSE)
+    {
+        return m_component_array;
+    }
+
+    std::span<const Entity> getEntities() const
+        requires(ArrayType == ComponentArrayType::SPARSE)
+    {
+        return m_dense_entities;
+    }
+
+private:
+    void resizeBlockChangeTicks()
+    {
+        const std::size_t block_count = (m_change_ticks.size() + CHANGE_TICK_BLOCK_SIZE - 1) / CHANGE_TICK_BLOCK_SIZE;
+        if (block_count > m_block_change_ticks.size()) {
+            m_block_change_ticks.resize(block_count, 0);
+        }
+    }
+
+    uint32_t getIndex(const Entity entity) const
     {
         GC_ASSERT(entity != ENTITY_NONE);
 
         uint32_t index{};
         if constexpr (ArrayType == ComponentArrayType::SPARSE) {
-            GC_ASSERT(m_entity_component_indices.contains(entity));
-            index = m_entity_component_indices[entity];
+            GC_ASSERT(entity / SPARSE_PAGE_SIZE < m_sparse_pages.size() && m_sparse_pages[entity / SPARSE_PAGE_SIZE]);
+            index = (*m_sparse_pages[entity / SPARSE_PAGE_SIZE])[entity % SPARSE_PAGE_SIZE];
         }
         else { // ComponentArrayType::DENSE
             index = entity;
         }
         GC_ASSERT(index < static_cast<uint32_t>(m_component_array.size()));
-        return m_component_array[index];
+        return index;
+    }
+
+    uint32_t findSparseIndex(const Entity entity) const
+    {
+        const uint32_t page_index = entity / SPARSE_PAGE_SIZE;
+        if (page_index >= m_sparse_pages.size() || !m_sparse_pages[page_index]) {
+            return INVALID_INDEX;
+        }
+        return (*m_sparse_pages[page_index])[entity % SPARSE_PAGE_SIZE];
     }
 };
 
@@ -204,3 +397,8 @@ public:
 };
 
 } // namespace gc
+
+template <>
+struct std::hash<gc::Signature> {
+    std::size_t operator()(const gc::Signature& signature) const noexcept { return signature.hash(); }
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+// Per-thread linear allocator for data that only lives until the end of the frame.
+// Allocating bumps a pointer and freeing does nothing. An arena is only reset where its thread can't be using any of it:
+// the main thread at the start of each frame, and job workers between top-level jobs once a new frame has begun.
+// Memory stays valid while the job that allocated it runs, even a background job spanning several frames,
+// but containers must not be kept after the job or frame that made them has ended, including across a co_await.
+// Any other thread using its arena must call reset() itself when none of the memory is in use.
+// An arena belongs to one thread, so a container must only grow on the thread that created it.
+// Growing a container on another thread, or after its arena has been reset, aborts.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <vector>
+
+#include "gamecore/gc_assert.h"
+
+namespace gc {
+
+class FrameArena {
+    static constexpr std::size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    std::vector<Block> m_blocks{};
+    std::size_t m_block_index{}; // block currently allocated from
+    std::size_t m_offset{};      // bytes used in the current block
+    std::size_t m_bytes_used{};  // in every block since the last reset
+    uint64_t m_generation{};     // incremented by reset()
+    uint64_t m_frame{};          // frame of the last reset
+
+public:
+    FrameArena() = default;
+    FrameArena(const FrameArena&) = delete;
+
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment);
+
+    // Frees everything. If the last frame needed more than one block they are merged into one big enough for it.
+    void reset();
+
+    // Resets if a frame has begun since the last reset. Called by job workers between top-level jobs.
+    void resetIfNewFrame();
+
+    std::size_t getBytesUsed() const { return m_bytes_used; }
+    uint64_t getGeneration() const { return m_generation; }
+
+    // Aborts unless this is the calling thread's arena and it hasn't been reset since 'generation'
+    void checkAllocation(uint64_t generation) const;
+
+    // The calling thread's arena
+    static FrameArena& local();
+
+    // Called by App on the main thread at the start of every frame. Resets the main thread's arena.
+    // Workers' arenas are reset the next time they finish a top-level job.
+    static void beginFrame();
+};
+
+// std compatible allocator using a FrameArena, by default the one of the thread constructing it
+template <typename T>
+class FrameAllocator {
+    template <typename U>
+    friend class FrameAllocator;
+
+    FrameArena* m_arena;
+    uint64_t m_generation; // catches containers kept after their arena was reset
+
+public:
+    using value_type = T;
+
+    FrameAllocator() : FrameAllocator(FrameArena::local()) {}
+    explicit FrameAllocator(FrameArena& arena) : m_arena(&arena), m_generation(arena.getGeneration()) {}
+
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>& other) : m_arena(other.m_arena), m_generation(other.m_generation) {}
+
+    T* allocate(std::size_t n)
+    {
+        m_arena->checkAllocation(m_generation);
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, std::size_t) {}
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U>& other) const
+    {
+        return m_arena == other.m_arena;
+    }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+} // namespace gc
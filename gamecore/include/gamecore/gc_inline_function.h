@@ -0,0 +1,101 @@
+#pragma once
+
+// A move-only std::function replacement that stores the callable inline and never allocates.
+// Callables larger than Capacity bytes are rejected at compile time, capture by reference or capture a pointer instead.
+
+#include <cstddef>
+
+#include <concepts>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "gamecore/gc_assert.h"
+
+namespace gc {
+
+template <typename Signature, std::size_t Capacity = 64>
+class InlineFunction;
+
+template <typename R, typename... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+    struct VTable {
+        R (*invoke)(void* storage, Args&&... args);
+        void (*move)(void* destination, void* source); // move constructs into destination then destroys source
+        void (*destroy)(void* storage);
+    };
+
+    template <typename F>
+    static constexpr VTable VTABLE_FOR{
+        [](void* storage, Args&&... args) -> R { return (*static_cast<F*>(storage))(std::forward<Args>(args)...); },
+        [](void* destination, void* source) {
+            ::new (destination) F(std::move(*static_cast<F*>(source)));
+            static_cast<F*>(source)->~F();
+        },
+        [](void* storage) { static_cast<F*>(storage)->~F(); },
+    };
+
+    alignas(std::max_align_t) std::byte m_storage[Capacity];
+    const VTable* m_vtable = nullptr;
+
+public:
+    InlineFunction() = default;
+
+    template <typename Func>
+        requires(!std::same_as<std::remove_cvref_t<Func>, InlineFunction> && std::is_invocable_r_v<R, std::remove_cvref_t<Func>&, Args...>)
+    InlineFunction(Func&& func) // implicit so lambdas can be passed directly
+    {
+        using F = std::remove_cvref_t<Func>;
+        static_assert(sizeof(F) <= Capacity, "Callable is too large for InlineFunction, capture less or capture a pointer to the state");
+        static_assert(alignof(F) <= alignof(std::max_align_t), "Callable is over-aligned for InlineFunction");
+        static_assert(std::is_nothrow_move_constructible_v<F>, "Callable must be nothrow move constructible");
+        ::new (static_cast<void*>(m_storage)) F(std::forward<Func>(func));
+        m_vtable = &VTABLE_FOR<F>;
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+
+    InlineFunction(InlineFunction&& other) noexcept : m_vtable(other.m_vtable)
+    {
+        if (m_vtable) {
+            m_vtable->move(m_storage, other.m_storage);
+            other.m_vtable = nullptr;
+        }
+    }
+
+    ~InlineFunction() { reset(); }
+
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    InlineFunction& operator=(InlineFunction&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            if (other.m_vtable) {
+                other.m_vtable->move(m_storage, other.m_storage);
+                m_vtable = other.m_vtable;
+                other.m_vtable = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    R operator()(Args... args)
+    {
+        GC_ASSERT(m_vtable);
+        return m_vtable->invoke(m_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const { return m_vtable != nullptr; }
+
+    // Destroys the stored callable
+    void reset()
+    {
+        if (m_vtable) {
+            m_vtable->destroy(m_storage);
+            m_vtable = nullptr;
+        }
+    }
+};
+
+} // namespace gc
@@ -1,15 +1,29 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
-#include <functional>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
-#include <condition_variable>
+#include <span>
+#include <thread>
+#include <vector>
 
+#include "gamecore/gc_inline_function.h"
 #include "gamecore/gc_ring_buffer.h"
+#include "gamecore/gc_work_stealing_deque.h"
 
 /* multithreaded job system */
+/* Each worker has its own work-stealing deque. Jobs submitted from a worker go on that worker's deque without locking, */
+/* jobs submitted from any other thread go on a shared lock-free injection queue. Idle workers steal from each other. */
+/* Job functions are stored inline and jobs and handles are recycled, so submitting jobs doesn't allocate once warmed up. */
+/* Threads waiting for jobs run queued jobs themselves while they wait. Idle workers spin briefly then park on a futex. */
+/* Since a waiting thread may run any queued job, a job must never block on another thread that might be waiting on it. */
+/* Background jobs only run when no frame-critical job is queued, and a thread waiting for frame-critical jobs never */
+/* picks up a background job, so a long background job can't delay the frame. */
 
 /* using a simple prime finder function to test (7700K, 4 Cores, 8 Hyperthreading): */
 /* No job system, single thread: 60s */
@@ -23,20 +37,131 @@ struct JobDispatchArgs {
     unsigned int group_index;
 };
 
+/* Captures must fit in JOB_FUNCTION_CAPACITY bytes. Capture by reference or capture a pointer to larger state. */
+constexpr std::size_t JOB_FUNCTION_CAPACITY = 64;
+using JobFunction = InlineFunction<void(), JOB_FUNCTION_CAPACITY>;
+using JobDispatchFunction = InlineFunction<void(JobDispatchArgs), JOB_FUNCTION_CAPACITY>;
+
+/* Buckets of the time between a job being queued and starting. Bucket 0 is under 1us, bucket i is [2^(i-1), 2^i) us, */
+/* and the last bucket also counts everything longer. */
+constexpr std::size_t JOB_LATENCY_BUCKET_COUNT = 16;
+
+/* Counters for one worker thread, or for every other thread that ran jobs while waiting */
+struct JobWorkerStats {
+    uint64_t jobs_executed;
+    std::chrono::nanoseconds busy_time;   // running jobs
+    std::chrono::nanoseconds parked_time; // asleep with nothing to do, always zero for non-worker threads
+    uint64_t steal_attempts;              // tried to steal from a worker whose deque wasn't empty
+    uint64_t steals;                      // of which succeeded, the rest lost a race with the owner or another thief
+};
+
+/* Snapshot returned by Jobs::getStats(). Counters cover the time since the job system was created or resetStats() was called. */
+struct JobStats {
+    std::chrono::nanoseconds elapsed;
+    std::vector<JobWorkerStats> workers; // one per worker thread
+    JobWorkerStats other_threads;        // threads that ran jobs inside wait(), usually the main thread
+    int64_t queued_jobs;                 // frame-critical jobs waiting to be picked up right now
+    int64_t queued_jobs_high_water;
+    int64_t queued_background_jobs;
+    uint64_t injection_overflows;        // times an injection queue was full and jobs went on its locked overflow list
+    std::array<uint64_t, JOB_LATENCY_BUCKET_COUNT> latency_histogram;
+};
+
+enum class JobPriority {
+    FRAME_CRITICAL, // work the current frame waits on
+    BACKGROUND,     // work that may take several frames, e.g. loading assets
+};
+
+class Jobs;
+
+/* Tracks the jobs created by one call to Jobs::execute() or Jobs::dispatch(). */
+/* Can be waited on with Jobs::wait(handle) or passed as a dependency of later jobs. */
+/* A default constructed handle refers to no jobs and is always done. */
+class JobHandle {
+    friend class Jobs;
+
+    struct Counter;
+    Counter* m_counter{}; // reference counted
+
+    // takes over a reference already added to the counter
+    explicit JobHandle(Counter* counter);
+
+    static void releaseReference(Counter* counter);
+
+public:
+    JobHandle() = default;
+    JobHandle(const JobHandle& other);
+    JobHandle(JobHandle&& other) noexcept;
+
+    ~JobHandle();
+
+    JobHandle& operator=(const JobHandle& other);
+    JobHandle& operator=(JobHandle&& other) noexcept;
+
+    bool isDone() const;
+
+    /* The job system the jobs were submitted to, nullptr for a default constructed handle */
+    Jobs* getJobs() const;
+};
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier, WorkerCounters and the ring buffers are aligned to cache lines on purpose
+#endif
+
 class Jobs {
+    friend class JobHandle;
+
+    struct Job;
+
+    /* Jobs from non-worker threads, and all background jobs. Lock-free unless the ring buffer fills up. */
+    struct InjectionQueue {
+        MPMCRingBuffer<Job*, 1024> ring;
+        Job* overflow_head = nullptr; // used when the ring is full, linked by Job::next
+        Job* overflow_tail = nullptr;
+        std::mutex overflow_mutex;
+        std::atomic<bool> overflowed = false; // the overflow list isn't empty, checked before taking the lock
+
+        /* Returns false if some jobs went on the overflow list */
+        bool push(Job* first, Job* last);
+        Job* pop();
+    };
+
+    /* Written with relaxed atomics by the thread it belongs to, read by getStats(). On its own cache line. */
+    struct alignas(64) WorkerCounters {
+        std::atomic<uint64_t> jobs_executed{};
+        std::atomic<int64_t> busy_ns{};
+        std::atomic<int64_t> parked_ns{};
+        std::atomic<uint64_t> steal_attempts{};
+        std::atomic<uint64_t> steals{};
+        std::array<std::atomic<uint64_t>, JOB_LATENCY_BUCKET_COUNT> latency_histogram{};
+    };
+
     const unsigned int m_num_threads;
-    RingBuffer<std::function<void()>, 256> m_ring_buffer;
-    std::mutex m_ring_buffer_mutex;
-    std::condition_variable m_wake_condition;
-    std::mutex m_wake_condition_mutex;
-    uint64_t m_current_label;
+    std::vector<std::unique_ptr<WorkStealingDeque<Job*>>> m_worker_queues; // one per worker
+    InjectionQueue m_injection_queue;  // frame-critical jobs submitted from non-worker threads
+    InjectionQueue m_background_queue; // every background job
+    std::atomic<int64_t> m_queued_jobs;            // frame-critical jobs pushed but not yet taken
+    std::atomic<int64_t> m_queued_background_jobs; // same for background jobs
+    std::atomic<unsigned int> m_num_threads_sleeping;
+    std::atomic<uint32_t> m_wake_epoch; // parked workers wait for this to change
+    std::atomic<uint64_t> m_current_label;
     std::atomic<uint64_t> m_finished_label;
     std::atomic<bool> m_shutdown_threads;
-    std::atomic<unsigned int> m_num_threads_running;
+    std::vector<JobFunction> m_main_thread_jobs;
+    std::vector<JobFunction> m_main_thread_jobs_running; // swapped with m_main_thread_jobs so jobs can queue more jobs
+    std::mutex m_main_thread_jobs_mutex;
+    std::unique_ptr<WorkerCounters[]> m_counters; // one per worker then one shared by every other thread
+    std::atomic<int64_t> m_queued_jobs_high_water;
+    std::atomic<uint64_t> m_injection_overflows;
+    std::atomic<int64_t> m_stats_start_ns;
+    std::vector<unsigned int> m_worker_cpus; // logical CPU each worker is pinned to, empty if not pinning
     std::vector<std::thread> m_workers;
 
 public:
-    explicit Jobs(unsigned int num_threads);
+    /* If pin_threads is set each worker is pinned to one logical CPU, see getCPUPlacementOrder(). */
+    /* The first CPU in that order is left free for the thread creating the job system, normally the main thread. */
+    explicit Jobs(unsigned int num_threads, bool pin_threads = false);
 
     ~Jobs();
 
@@ -47,20 +172,72 @@ public:
     Jobs& operator=(Jobs&&) = delete;
 
     /* Add a job to execute asynchronously, any idle thread will execute this job. */
-    /* If the job buffer is full, this function will block until space is available. */
-    void execute(const std::function<void()>& func);
+    /* The job won't start until every job in 'dependencies' has finished. */
+    JobHandle execute(JobFunction func, std::span<const JobHandle> dependencies = {}, JobPriority priority = JobPriority::FRAME_CRITICAL);
 
     /* Divide a job onto multiple jobs and execute in parallel. */
-    /* If the job buffer is full, this function will block until space is available. */
     /*    job_count       : how many jobs to generate for this task */
     /*    group_size      : how many jobs to execute per thread */
     /*                      less threads may be used depending on how fast jobs take */
-    void dispatch(unsigned int job_count, unsigned int group_size, const std::function<void(JobDispatchArgs)>& func);
+    /*    dependencies    : none of the jobs start until every job in these handles has finished */
+    /* 'func' is shared by every group rather than copied into each one */
+    JobHandle dispatch(unsigned int job_count, unsigned int group_size, JobDispatchFunction func, std::span<const JobHandle> dependencies = {},
+                       JobPriority priority = JobPriority::FRAME_CRITICAL);
+
+    /* Queue a job to run on the main thread the next time it calls runMainThreadJobs(). Can be called from any thread. */
+    /* These jobs aren't tracked by handles or by wait(). */
+    void executeOnMainThread(JobFunction func);
+
+    /* Runs the jobs queued by executeOnMainThread(). Called once per frame by App. */
+    /* Jobs queued while these are running are run on the next call. */
+    void runMainThreadJobs();
+
+    unsigned int getNumThreads() const { return m_num_threads; }
 
     bool isBusy();
 
-    /* wait until all threads are idle */
+    /* wait until all threads are idle, running queued jobs of either priority in the meantime */
+    /* must not be called from a job since that job would be waiting for itself */
     void wait();
+
+    /* wait until only the jobs tracked by 'handle' have finished, running queued jobs in the meantime */
+    /* only waits on background handles help with background jobs */
+    /* may be called from a job */
+    void wait(const JobHandle& handle);
+
+    /* Always collected. Counters are read one at a time while workers keep running so they may be slightly inconsistent. */
+    JobStats getStats() const;
+
+    /* Zeroes the counters, e.g. before measuring one part of a frame */
+    void resetStats();
+
+private:
+    /* Both come from pools. The counter starts with a reference for the returned handle and one for each job. */
+    JobHandle::Counter* acquireCounter(unsigned int job_count, JobPriority priority);
+    static Job* acquireJob(JobFunction&& func, JobHandle::Counter* counter);
+
+    /* Queues the counter's jobs (a list linked by Job::next) once all dependencies have finished */
+    void submit(JobHandle::Counter* counter, Job* first, Job* last, std::span<const JobHandle> dependencies);
+
+    void runJob(Job* job);
+
+    /* Called once for each dependency of the counter's jobs, queues them after the last one */
+    void releaseDependency(JobHandle::Counter* counter);
+
+    void workerLoop(unsigned int thread_id);
+
+    /* The counters of the calling thread */
+    WorkerCounters& localCounters();
+
+    /* Finds a job for the calling thread: its own deque first if it is a worker, then the injection queue, then workers' deques, */
+    /* then if allowed the background queue */
+    Job* findJob(bool include_background);
+
+    void pushJobs(Job* first, Job* last, unsigned int count);
 };
 
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
 } // namespace gc
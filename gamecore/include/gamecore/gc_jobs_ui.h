@@ -0,0 +1,9 @@
+#pragma once
+
+namespace gc {
+
+class Jobs; // forward-dec
+
+void renderJobsUI(Jobs& jobs);
+
+} // namespace gc
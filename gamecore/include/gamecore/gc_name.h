@@ -12,6 +12,7 @@
 #include <cstdint>
 
 #include <string>
+#include <string_view>
 #include <filesystem>
 #include <fstream>
 #include <unordered_map>
@@ -44,9 +45,16 @@ public:
         s_lut.emplace(m_hash, str);
     }
     explicit Name(const std::string& str) : Name(str.c_str()) {}
+    explicit Name(std::string_view str) : Name(crc32(str))
+    {
+        std::unique_lock lock(s_lut_mutex);
+        s_lut.emplace(m_hash, str);
+    }
 #else
     explicit constexpr Name(const char* str) : Name(crc32(str)) {}
     explicit constexpr Name(const std::string& str) : Name(str.c_str()) {}
+    // hashes the characters in place, so a substring doesn't have to be copied into a std::string first
+    explicit constexpr Name(std::string_view str) : Name(crc32(str)) {}
 #endif
 
     constexpr bool operator==(const Name& other) const noexcept { return m_hash == other.m_hash; }
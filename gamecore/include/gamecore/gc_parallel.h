@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <concepts>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gamecore/gc_assert.h"
+#include "gamecore/gc_jobs.h"
+
+/*
+ * Parallel algorithms built on gc::Jobs.
+ * Work is split into contiguous chunks, one job per chunk, and the calling thread waits for (and helps with) the chunks.
+ * Pass grain = 0 to pick the chunk size automatically: about four chunks per worker, but never smaller than MIN_PARALLEL_GRAIN
+ * elements so the cost of a job is spread over enough work. Inputs that would only make one chunk run on the calling thread.
+ * Results never depend on how the work was split: reductions and scans combine chunks in order so 'op' only needs to be associative.
+ */
+
+namespace gc {
+
+constexpr std::size_t MIN_PARALLEL_GRAIN = 256;
+
+namespace detail {
+
+inline std::size_t chooseGrain(const Jobs& jobs, std::size_t count, std::size_t grain)
+{
+    if (grain != 0) {
+        return grain;
+    }
+    const std::size_t target_chunks = static_cast<std::size_t>(jobs.getNumThreads()) * 4;
+    return std::max(MIN_PARALLEL_GRAIN, (count + target_chunks - 1) / target_chunks);
+}
+
+inline std::size_t chunkCount(std::size_t count, std::size_t grain) { return (count + grain - 1) / grain; }
+
+// Calls func(chunk_index, begin, end) for each chunk of [0, count) and waits for them all
+template <typename Func>
+void forEachChunk(Jobs& jobs, std::size_t count, std::size_t grain, Func&& func)
+{
+    GC_ASSERT(grain > 0);
+    const std::size_t chunks = chunkCount(count, grain);
+    if (chunks <= 1) {
+        if (count > 0) {
+            func(std::size_t{0}, std::size_t{0}, count);
+        }
+        return;
+    }
+    jobs.wait(jobs.dispatch(static_cast<unsigned int>(chunks), 1, [&](JobDispatchArgs args) {
+        const std::size_t begin = args.job_index * grain;
+        func(static_cast<std::size_t>(args.job_index), begin, std::min(begin + grain, count));
+    }));
+}
+
+} // namespace detail
+
+// Calls func(i) for every i in [begin, end)
+template <typename Func>
+void parallelFor(Jobs& jobs, std::size_t begin, std::size_t end, Func&& func, std::size_t grain = 0)
+{
+    GC_ASSERT(begin <= end);
+    const std::size_t count = end - begin;
+    detail::forEachChunk(jobs, count, detail::chooseGrain(jobs, count, grain), [&](std::size_t, std::size_t chunk_begin, std::size_t chunk_end) {
+        for (std::size_t i = begin + chunk_begin; i < begin + chunk_end; ++i) {
+            func(i);
+        }
+    });
+}
+
+// Returns reduce(...reduce(reduce(identity, map(begin)), map(begin + 1))..., map(end - 1)) in that order but computed in parallel.
+// 'reduce' must be associative and 'identity' must be its identity element.
+template <typename T, typename MapFunc, typename ReduceFunc>
+T parallelReduce(Jobs& jobs, std::size_t begin, std::size_t end, T identity, MapFunc&& map, ReduceFunc&& reduce, std::size_t grain = 0)
+{
+    GC_ASSERT(begin <= end);
+    const std::size_t count = end - begin;
+    grain = detail::chooseGrain(jobs, count, grain);
+
+    std::vector<T> partials(detail::chunkCount(count, grain), identity);
+    detail::forEachChunk(jobs, count, grain, [&](std::size_t chunk, std::size_t chunk_begin, std::size_t chunk_end) {
+        T partial = identity;
+        for (std::size_t i = begin + chunk_begin; i < begin + chunk_end; ++i) {
+            partial = reduce(std::move(partial), map(i));
+        }
+        partials[chunk] = std::move(partial);
+    });
+
+    T result = std::move(identity);
+    for (T& partial : partials) {
+        result = reduce(std::move(result), std::move(partial));
+    }
+    return result;
+}
+
+// output[i] = input[0] op input[1] op ... op input[i]
+// input and output may be the same span
+template <typename T, typename Op = std::plus<>>
+void parallelInclusiveScan(Jobs& jobs, std::span<const T> input, std::span<T> output, Op op = {}, std::size_t grain = 0);
+
+// output[0] = init, output[i] = init op input[0] op ... op input[i - 1]
+// input and output may be the same span. Useful for turning per-element counts into offsets when compacting.
+template <typename T, typename Op = std::plus<>>
+void parallelExclusiveScan(Jobs& jobs, std::span<const T> input, std::span<T> output, T init, Op op = {}, std::size_t grain = 0);
+
+namespace detail {
+
+// Two passes: each chunk is reduced in parallel, the chunk totals are scanned on the calling thread,
+// then each chunk is scanned in parallel starting from the total of the chunks before it.
+template <bool INCLUSIVE, typename T, typename Op>
+void parallelScan(Jobs& jobs, std::span<const T> input, std::span<T> output, const T* init, Op& op, std::size_t grain)
+{
+    GC_ASSERT(input.size() == output.size());
+    const std::size_t count = input.size();
+    grain = chooseGrain(jobs, count, grain);
+    const std::size_t chunks = chunkCount(count, grain);
+
+    // chunk_totals[c] is every element of chunk c combined
+    std::vector<T> chunk_totals(chunks);
+    if (chunks > 1) {
+        forEachChunk(jobs, count, grain, [&](std::size_t chunk, std::size_t chunk_begin, std::size_t chunk_end) {
+            T total = input[chunk_begin];
+            for (std::size_t i = chunk_begin + 1; i < chunk_end; ++i) {
+                total = op(std::move(total), input[i]);
+            }
+            chunk_totals[chunk] = std::move(total);
+        });
+    }
+
+    forEachChunk(jobs, count, grain, [&](std::size_t chunk, std::size_t chunk_begin, std::size_t chunk_end) {
+        // combine the totals of the preceding chunks. Cheap since there are only a few chunks per worker.
+        bool has_running = (init != nullptr);
+        T running = has_running ? *init : T{};
+        for (std::size_t c = 0; c < chunk; ++c) {
+            running = has_running ? op(std::move(running), chunk_totals[c]) : chunk_totals[c];
+            has_running = true;
+        }
+        for (std::size_t i = chunk_begin; i < chunk_end; ++i) {
+            T value = input[i]; // read before writing in case input and output alias
+            if constexpr (INCLUSIVE) {
+                running = has_running ? op(std::move(running), std::move(value)) : std::move(value);
+                has_running = true;
+                output[i] = running;
+            }
+            else {
+                output[i] = running;
+                running = op(std::move(running), std::move(value));
+            }
+        }
+    });
+}
+
+// Sorts the items by the unsigned integer returned from key(), one byte per pass. Stable.
+template <typename T, typename KeyFunc>
+void parallelRadixSort(Jobs& jobs, std::span<T> items, KeyFunc& key, std::size_t grain)
+{
+    using Key = std::remove_cvref_t<std::invoke_result_t<KeyFunc&, const T&>>;
+    static_assert(std::unsigned_integral<Key>, "Radix sort keys must be unsigned integers");
+
+    constexpr std::size_t RADIX = 256;
+    const std::size_t count = items.size();
+    grain = chooseGrain(jobs, count, grain);
+    const std::size_t chunks = chunkCount(count, grain);
+
+    std::vector<T> scratch(count);
+    std::vector<std::size_t> offsets(chunks * RADIX); // offsets[chunk * RADIX + digit]
+    std::span<T> source = items;
+    std::span<T> destination = scratch;
+
+    for (unsigned int shift = 0; shift < sizeof(Key) * 8; shift += 8) {
+        // count how many of each digit every chunk has
+        std::ranges::fill(offsets, 0);
+        forEachChunk(jobs, count, grain, [&](std::size_t chunk, std::size_t chunk_begin, std::size_t chunk_end) {
+            std::size_t* const histogram = &offsets[chunk * RADIX];
+            for (std::size_t i = chunk_begin; i < chunk_end; ++i) {
+                ++histogram[(key(source[i]) >> shift) & (RADIX - 1)];
+            }
+        });
+
+        // skip passes where every key has the same digit, common for small keys in wide integers
+        bool all_same_digit = false;
+        for (std::size_t digit = 0; digit < RADIX && !all_same_digit; ++digit) {
+            std::size_t digit_count = 0;
+            for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+                digit_count += offsets[chunk * RADIX + digit];
+            }
+            all_same_digit = (digit_count == count);
+        }
+        if (all_same_digit) {
+            continue;
+        }
+
+        // turn the histograms into where each chunk writes each digit, digit-major so the sort is stable
+        std::size_t offset = 0;
+        for (std::size_t digit = 0; digit < RADIX; ++digit) {
+            for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+                const std::size_t digit_count = offsets[chunk * RADIX + digit];
+                offsets[chunk * RADIX + digit] = offset;
+                offset += digit_count;
+            }
+        }
+
+        forEachChunk(jobs, count, grain, [&](std::size_t chunk, std::size_t chunk_begin, std::size_t chunk_end) {
+            std::size_t* const chunk_offsets = &offsets[chunk * RADIX];
+            for (std::size_t i = chunk_begin; i < chunk_end; ++i) {
+                destination[chunk_offsets[(key(source[i]) >> shift) & (RADIX - 1)]++] = std::move(source[i]);
+            }
+        });
+        std::swap(source, destination);
+    }
+
+    if (source.data() != items.data()) {
+        parallelFor(jobs, 0, count, [&](std::size_t i) { items[i] = std::move(source[i]); }, grain);
+    }
+}
+
+} // namespace detail
+
+template <typename T, typename Op>
+void parallelInclusiveScan(Jobs& jobs, std::span<const T> input, std::span<T> output, Op op, std::size_t grain)
+{
+    detail::parallelScan<true>(jobs, input, output, static_cast<const T*>(nullptr), op, grain);
+}
+
+template <typename T, typename Op>
+void parallelExclusiveScan(Jobs& jobs, std::span<const T> input, std::span<T> output, T init, Op op, std::size_t grain)
+{
+    detail::parallelScan<false>(jobs, input, output, &init, op, grain);
+}
+
+// Stable LSD radix sort by an unsigned integer key, e.g. a draw list sorted by a packed material/mesh/depth key.
+// Needs a scratch copy of the items so T must be default constructible.
+template <typename T, typename KeyFunc>
+void parallelRadixSort(Jobs& jobs, std::span<T> items, KeyFunc key, std::size_t grain = 0)
+{
+    detail::parallelRadixSort(jobs, items, key, grain);
+}
+
+// Sorts chunks in parallel then merges neighbouring runs in parallel rounds. Not stable.
+// Ranges of unsigned integers sorted with the default comparison use parallelRadixSort() instead.
+template <std::random_access_iterator It, typename Compare = std::less<>>
+void parallelSort(Jobs& jobs, It first, It last, Compare comp = {}, std::size_t grain = 0)
+{
+    using T = std::iter_value_t<It>;
+    const auto count = static_cast<std::size_t>(last - first);
+
+    if constexpr (std::unsigned_integral<T> && std::same_as<Compare, std::less<>> && std::contiguous_iterator<It>) {
+        parallelRadixSort(jobs, std::span<T>(std::to_address(first), count), [](T value) { return value; }, grain);
+    }
+    else {
+        grain = detail::chooseGrain(jobs, count, grain);
+        detail::forEachChunk(jobs, count, grain, [&](std::size_t, std::size_t chunk_begin, std::size_t chunk_end) {
+            std::sort(first + chunk_begin, first + chunk_end, comp);
+        });
+
+        // each round merges pairs of sorted runs, doubling the run length
+        for (std::size_t run = grain; run < count; run *= 2) {
+            const std::size_t pairs = (count + 2 * run - 1) / (2 * run);
+            detail::forEachChunk(jobs, pairs, 1, [&](std::size_t pair, std::size_t, std::size_t) {
+                const std::size_t begin = pair * 2 * run;
+                const std::size_t middle = std::min(begin + run, count);
+                const std::size_t end = std::min(begin + 2 * run, count);
+                std::inplace_merge(first + begin, first + middle, first + end, comp);
+            });
+        }
+    }
+}
+
+} // namespace gc
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <span>
+#include <vector>
 
 #include "gamecore/gc_ecs.h"
 
@@ -8,7 +9,11 @@ namespace gc {
 
 class World; // forward-dec
 
-// returns the number of loaded entities
+// returns the root entity of the prefab
 Entity loadPrefab(std::span<const uint8_t> data, World& world, Entity prefab_parent = ENTITY_NONE);
 
+// Creates 'count' copies of the prefab, decoding it only once and reserving World storage up front.
+// Returns the root entity of each copy.
+std::vector<Entity> instantiatePrefab(std::span<const uint8_t> data, World& world, uint32_t count, Entity prefab_parent = ENTITY_NONE);
+
 } // namespace gc
\ No newline at end of file
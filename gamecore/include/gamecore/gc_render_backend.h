@@ -121,6 +121,8 @@ class RenderBackend {
     
     std::unique_ptr<RenderBuffer> m_frame_uniform_buffer{};
     std::unique_ptr<RenderBuffer> m_instancing_transforms_buffer{};
+    std::unique_ptr<RenderBuffer> m_static_instancing_transforms_buffer{}; // only written when StaticDrawBatches::generation changes
+    uint64_t m_static_instancing_transforms_generation{};
     
     std::unique_ptr<GPUDescriptorSet> m_frame_uniform_buffer_set{}; // permanently points to m_frame_uniform_buffer
 
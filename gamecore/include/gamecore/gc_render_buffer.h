@@ -51,6 +51,13 @@ public:
 
     VkBuffer getBuffer() const;
 
+    // For buffers that are read in frames where writeData() isn't called, so the buffer isn't freed while still in use
+    void useResource(VkSemaphore timeline_semaphore, uint64_t signal_value)
+    {
+        m_timeline_semaphore = timeline_semaphore;
+        m_resource_free_signal_value = signal_value;
+    }
+
 private:
     void freeBuffers();
     void reallocate(VkDeviceSize new_capacity);
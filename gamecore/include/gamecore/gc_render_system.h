@@ -9,10 +9,13 @@
 #include "gamecore/gc_ecs.h"
 #include "gamecore/gc_name.h"
 #include "gamecore/gc_render_object_manager.h"
+#include "gamecore/gc_renderable_component.h"
+#include "gamecore/gc_transform_component.h"
+#include "gamecore/gc_world.h"
+#include "gamecore/gc_world_draw_data.h"
 
 namespace gc {
 
-class World;       // forward-dec
 struct FrameState; // forward-dec
 
 class RenderSystem : public System {
@@ -29,13 +32,52 @@ private:
         }
     };
 
+    // entities[i] owns transforms[i]
+    struct InstanceGroup {
+        std::vector<glm::mat4> transforms;
+        std::vector<Entity> entities;
+        uint32_t static_transform_offset{}; // where the group's transforms start in m_static_draw_batches, set by bakeStaticBatches()
+    };
+
+    // Where an entity's instance is, indexed by entity. mesh is nullptr if the entity isn't drawn.
+    struct InstanceLocation {
+        RenderMesh* mesh;
+        RenderMaterial* material;
+        uint32_t index;
+        bool is_static;  // in m_static_instance_groups instead of m_instance_groups
+        bool unresolved; // should be drawn but its mesh or material couldn't be found, in m_unresolved_entities
+    };
+
+    using InstanceGroupMap = std::unordered_map<std::pair<RenderMesh*, RenderMaterial*>, InstanceGroup, MeshMaterialPairHash>;
+
     RenderObjectManager m_render_object_manager;
-    std::unordered_map<std::pair<RenderMesh*, RenderMaterial*>, std::vector<glm::mat4>, MeshMaterialPairHash> m_instance_groups;
+    Query<const TransformComponent, const RenderableComponent> m_renderables;
+
+    // Instance groups persist between frames and are only updated for entities whose transform or renderable has changed or been removed
+    InstanceGroupMap m_instance_groups;
+    std::vector<InstanceLocation> m_instance_locations;
+    uint32_t m_last_update_tick{};
+
+    // Entities whose mesh or material couldn't be resolved. They are retried every frame as the content may become available later.
+    std::vector<Entity> m_unresolved_entities;
+    std::vector<Entity> m_retry_entities; // scratch for onUpdate()
+
+    // Static entities (see TransformComponent::isStatic()) are grouped separately and baked into m_static_draw_batches,
+    // which is only rebuilt when a static instance is added or removed. A static instance that moves is patched in place.
+    InstanceGroupMap m_static_instance_groups;
+    StaticDrawBatches m_static_draw_batches{};
+    bool m_static_batches_dirty{};
+    bool m_static_transforms_changed{}; // a baked transform was patched, the generation must be bumped so the backend uploads it
 
 public:
     RenderSystem(World& world, ResourceManager& resource_manager, RenderBackend& render_backend);
 
     void onUpdate(FrameState& frame_state) override;
+
+private:
+    void updateInstance(Entity entity, const TransformComponent& t, const RenderableComponent& c);
+    void removeInstance(Entity entity);
+    void bakeStaticBatches();
 };
 
 } // namespace gc
@@ -1,12 +1,18 @@
 #pragma once
 
-// A basic fixed-size ring buffer.
-// This class is not thread safe
+// Fixed-size ring buffers.
+// RingBuffer is not thread safe.
+// MPMCRingBuffer is lock-free for any number of producer and consumer threads.
+// SPSCRingBuffer is lock-free for exactly one producer thread and one consumer thread, and cheaper than MPMCRingBuffer.
+// The thread safe buffers construct elements in place when pushed and destroy them when popped, so T can be move-only.
 
 #include <cstddef>
 
 #include <array>
+#include <atomic>
+#include <new>
 #include <optional>
+#include <utility>
 
 namespace gc {
 
@@ -26,7 +32,7 @@ public:
         bool result = false;
         const std::size_t next = (m_head + 1) % m_buffer.size();
         if (next != m_tail) {
-            m_buffer[m_head] = item;
+            m_buffer[m_head] = std::move(item);
             m_head = next;
             result = true;
         }
@@ -36,7 +42,7 @@ public:
     inline std::optional<T> popFront()
     {
         if (m_tail != m_head) {
-            T item = m_buffer[m_tail];
+            T item = std::move(m_buffer[m_tail]);
             m_tail = (m_tail + 1) % m_buffer.size();
             return item;
         }
@@ -46,4 +52,184 @@ public:
     }
 };
 
+// Keeps the indices written by different threads on different cache lines
+inline constexpr std::size_t RING_BUFFER_CACHE_LINE_SIZE = 64;
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier, which is what the indices are aligned for
+#endif
+
+// Bounded queue based on Dmitry Vyukov's MPMC queue.
+// Each slot has a sequence number that says whether it is waiting to be written or read on the current lap around the ring,
+// so producers and consumers only contend on their own index and never wait for each other.
+template <typename T, std::size_t Capacity>
+class alignas(RING_BUFFER_CACHE_LINE_SIZE) MPMCRingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    std::array<Slot, Capacity> m_slots;
+    alignas(RING_BUFFER_CACHE_LINE_SIZE) std::atomic<std::size_t> m_push_index{0};
+    alignas(RING_BUFFER_CACHE_LINE_SIZE) std::atomic<std::size_t> m_pop_index{0};
+
+public:
+    MPMCRingBuffer()
+    {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPMCRingBuffer(const MPMCRingBuffer&) = delete;
+
+    ~MPMCRingBuffer()
+    {
+        while (tryPop()) {
+        }
+    }
+
+    MPMCRingBuffer& operator=(const MPMCRingBuffer&) = delete;
+
+    // Returns false if the buffer is full
+    template <typename... Args>
+    bool tryEmplace(Args&&... args)
+    {
+        std::size_t index = m_push_index.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = m_slots[index & (Capacity - 1)];
+            const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(index);
+            if (diff == 0) {
+                // slot is free on this lap, claim it
+                if (m_push_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+                    ::new (static_cast<void*>(slot.storage)) T(std::forward<Args>(args)...);
+                    slot.sequence.store(index + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // slot still holds an item from the previous lap
+            }
+            else {
+                index = m_push_index.load(std::memory_order_relaxed); // another producer claimed it
+            }
+        }
+    }
+
+    bool tryPush(T&& item) { return tryEmplace(std::move(item)); }
+    bool tryPush(const T& item) { return tryEmplace(item); }
+
+    // Returns nothing if the buffer is empty
+    std::optional<T> tryPop()
+    {
+        std::size_t index = m_pop_index.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = m_slots[index & (Capacity - 1)];
+            const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(index + 1);
+            if (diff == 0) {
+                // slot has been written on this lap, claim it
+                if (m_pop_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+                    T* const item = std::launder(reinterpret_cast<T*>(slot.storage));
+                    std::optional<T> result(std::move(*item));
+                    item->~T();
+                    slot.sequence.store(index + Capacity, std::memory_order_release);
+                    return result;
+                }
+            }
+            else if (diff < 0) {
+                return std::nullopt; // slot hasn't been written yet
+            }
+            else {
+                index = m_pop_index.load(std::memory_order_relaxed); // another consumer claimed it
+            }
+        }
+    }
+
+    // Only a hint while other threads are pushing or popping
+    std::size_t sizeApprox() const
+    {
+        const std::size_t push_index = m_push_index.load(std::memory_order_relaxed);
+        const std::size_t pop_index = m_pop_index.load(std::memory_order_relaxed);
+        return push_index > pop_index ? push_index - pop_index : 0;
+    }
+};
+
+// Bounded queue for exactly one producer thread and one consumer thread.
+// Each side caches the other side's index and only reloads it when the buffer looks full or empty.
+template <typename T, std::size_t Capacity>
+class alignas(RING_BUFFER_CACHE_LINE_SIZE) SPSCRingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    struct Slot {
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    std::array<Slot, Capacity> m_slots;
+
+    // consumer side
+    alignas(RING_BUFFER_CACHE_LINE_SIZE) std::atomic<std::size_t> m_pop_index{0};
+    std::size_t m_cached_push_index{0};
+
+    // producer side
+    alignas(RING_BUFFER_CACHE_LINE_SIZE) std::atomic<std::size_t> m_push_index{0};
+    std::size_t m_cached_pop_index{0};
+
+public:
+    SPSCRingBuffer() = default;
+    SPSCRingBuffer(const SPSCRingBuffer&) = delete;
+
+    ~SPSCRingBuffer()
+    {
+        while (tryPop()) {
+        }
+    }
+
+    SPSCRingBuffer& operator=(const SPSCRingBuffer&) = delete;
+
+    // Producer thread only. Returns false if the buffer is full.
+    template <typename... Args>
+    bool tryEmplace(Args&&... args)
+    {
+        const std::size_t index = m_push_index.load(std::memory_order_relaxed);
+        if (index - m_cached_pop_index == Capacity) {
+            m_cached_pop_index = m_pop_index.load(std::memory_order_acquire);
+            if (index - m_cached_pop_index == Capacity) {
+                return false;
+            }
+        }
+        ::new (static_cast<void*>(m_slots[index & (Capacity - 1)].storage)) T(std::forward<Args>(args)...);
+        m_push_index.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPush(T&& item) { return tryEmplace(std::move(item)); }
+    bool tryPush(const T& item) { return tryEmplace(item); }
+
+    // Consumer thread only. Returns nothing if the buffer is empty.
+    std::optional<T> tryPop()
+    {
+        const std::size_t index = m_pop_index.load(std::memory_order_relaxed);
+        if (index == m_cached_push_index) {
+            m_cached_push_index = m_push_index.load(std::memory_order_acquire);
+            if (index == m_cached_push_index) {
+                return std::nullopt;
+            }
+        }
+        T* const item = std::launder(reinterpret_cast<T*>(m_slots[index & (Capacity - 1)].storage));
+        std::optional<T> result(std::move(*item));
+        item->~T();
+        m_pop_index.store(index + 1, std::memory_order_release);
+        return result;
+    }
+};
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
 } // namespace gc
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "gamecore/gc_abort.h"
+#include "gamecore/gc_assert.h"
+#include "gamecore/gc_jobs.h"
+
+/*
+ * Coroutines on top of the job system.
+ * A gc::Task<T> is a lazily started coroutine. It either runs when another coroutine co_awaits it, resuming the awaiting
+ * coroutine when it finishes, or is started on a worker with start() and polled with isDone().
+ * Inside a task:
+ *   co_await other_task;                     runs other_task and returns its result
+ *   co_await job_handle;                     resumes on a worker once the jobs have finished
+ *   co_await switchToWorker(jobs);           resumes on a worker
+ *   co_await switchToWorker(jobs, priority); resumes on a worker and runs at 'priority' from then on
+ *   co_await switchToMainThread(jobs);       resumes in Jobs::runMainThreadJobs(), once per frame
+ * For example loading an asset: read on a worker, decode with a dispatch, then upload and register on the main thread.
+ * A task resumes on workers at its own priority, set by start() or switchToWorker() and passed on to tasks it awaits,
+ * so a background task stays in the background however it is resumed.
+ */
+
+namespace gc {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+class TaskPromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        // The task isn't marked done here as its owner could destroy the frame before this has returned.
+        // The continuation marks it done instead, once control has been transferred out of the frame.
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> coroutine) noexcept
+        {
+            GC_ASSERT(coroutine.promise().m_continuation);
+            return coroutine.promise().m_continuation;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::coroutine_handle<> m_continuation{};
+    std::atomic<bool> m_done{false};
+    JobPriority m_priority = JobPriority::FRAME_CRITICAL;
+
+public:
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() const { abortGame("Unhandled exception in gc::Task"); }
+
+    void setContinuation(std::coroutine_handle<> continuation) { m_continuation = continuation; }
+    bool isDone() const { return m_done.load(std::memory_order_acquire); }
+    // Only called after the task has suspended for the last time, the frame may be destroyed as soon as this returns
+    void markDone() { m_done.store(true, std::memory_order_release); }
+
+    void setPriority(JobPriority priority) { m_priority = priority; }
+    JobPriority getPriority() const { return m_priority; }
+};
+
+// The priority to resume a suspended coroutine at. Coroutines that aren't tasks are frame-critical.
+template <typename Promise>
+JobPriority getResumePriority(std::coroutine_handle<Promise> coroutine)
+{
+    if constexpr (std::is_base_of_v<TaskPromiseBase, Promise>) {
+        return coroutine.promise().getPriority();
+    }
+    else {
+        return JobPriority::FRAME_CRITICAL;
+    }
+}
+
+// The continuation of a started task, which has nothing awaiting it. Resuming it marks the task done and then it destroys itself.
+struct MarkDoneCoroutine {
+    struct promise_type {
+        MarkDoneCoroutine get_return_object() { return MarkDoneCoroutine{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const {}
+        void unhandled_exception() const { abortGame("Unhandled exception in gc::Task"); }
+    };
+
+    std::coroutine_handle<promise_type> coroutine;
+};
+
+inline MarkDoneCoroutine markDoneOnResume(TaskPromiseBase& task_promise)
+{
+    task_promise.markDone();
+    co_return;
+}
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+    std::optional<T> m_result{};
+
+public:
+    Task<T> get_return_object();
+
+    template <typename U>
+    void return_value(U&& value)
+    {
+        m_result.emplace(std::forward<U>(value));
+    }
+
+    T& getResult()
+    {
+        GC_ASSERT(m_result.has_value());
+        return *m_result;
+    }
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object();
+
+    void return_void() const {}
+    void getResult() const {}
+};
+
+template <typename T>
+struct TaskAwaiter {
+    std::coroutine_handle<TaskPromise<T>> coroutine;
+
+    bool await_ready() const noexcept { return false; }
+
+    // the task inherits the awaiting task's priority
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept
+    {
+        coroutine.promise().setContinuation(awaiting);
+        coroutine.promise().setPriority(getResumePriority(awaiting));
+        return coroutine;
+    }
+
+    T await_resume()
+    {
+        coroutine.promise().markDone();
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(coroutine.promise().getResult());
+        }
+    }
+};
+
+struct JobHandleAwaiter {
+    JobHandle handle;
+
+    bool await_ready() const noexcept { return handle.isDone(); }
+
+    // the coroutine may resume and destroy this awaiter before execute() returns, so nothing may be touched afterwards
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> coroutine)
+    {
+        handle.getJobs()->execute([coroutine] { coroutine.resume(); }, std::span(&handle, 1), getResumePriority(coroutine));
+    }
+
+    void await_resume() const noexcept {}
+};
+
+} // namespace detail
+
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+private:
+    std::coroutine_handle<promise_type> m_coroutine{};
+    bool m_started = false; // by start()
+
+public:
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> coroutine) : m_coroutine(coroutine) {}
+    Task(const Task&) = delete;
+    Task(Task&& other) noexcept : m_coroutine(std::exchange(other.m_coroutine, {})), m_started(std::exchange(other.m_started, false)) {}
+
+    ~Task()
+    {
+        if (m_coroutine) {
+            // a started task's frame is still in use until it is done
+            GC_ASSERT(!m_started || m_coroutine.promise().isDone());
+            m_coroutine.destroy();
+        }
+    }
+
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_coroutine) {
+                GC_ASSERT(!m_started || m_coroutine.promise().isDone());
+                m_coroutine.destroy();
+            }
+            m_coroutine = std::exchange(other.m_coroutine, {});
+            m_started = std::exchange(other.m_started, false);
+        }
+        return *this;
+    }
+
+    // Runs the task on a worker without anything awaiting it. Poll isDone() then read getResult().
+    void start(Jobs& jobs, JobPriority priority = JobPriority::FRAME_CRITICAL)
+    {
+        GC_ASSERT(m_coroutine && !m_started);
+        m_started = true;
+        m_coroutine.promise().setPriority(priority);
+        m_coroutine.promise().setContinuation(detail::markDoneOnResume(m_coroutine.promise()).coroutine);
+        jobs.execute([coroutine = m_coroutine] { coroutine.resume(); }, {}, priority);
+    }
+
+    bool isDone() const { return m_coroutine && m_coroutine.promise().isDone(); }
+
+    decltype(auto) getResult()
+    {
+        GC_ASSERT(isDone());
+        return m_coroutine.promise().getResult();
+    }
+
+    // Starts the task on the current thread. The awaiting coroutine resumes on whichever thread the task finishes on.
+    auto operator co_await() noexcept
+    {
+        GC_ASSERT(m_coroutine && !m_started);
+        return detail::TaskAwaiter<T>{m_coroutine};
+    }
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() { return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this)); }
+
+} // namespace detail
+
+// Suspends until the jobs tracked by the handle have finished then resumes on a worker at the task's priority
+inline auto operator co_await(JobHandle handle) noexcept { return detail::JobHandleAwaiter{std::move(handle)}; }
+
+namespace detail {
+
+struct SwitchToWorkerAwaiter {
+    Jobs& jobs;
+    std::optional<JobPriority> priority; // keeps the task's priority if empty
+
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> coroutine)
+    {
+        if constexpr (std::is_base_of_v<TaskPromiseBase, Promise>) {
+            if (priority) {
+                coroutine.promise().setPriority(*priority);
+            }
+        }
+        jobs.execute([coroutine] { coroutine.resume(); }, {}, priority.value_or(getResumePriority(coroutine)));
+    }
+
+    void await_resume() const noexcept {}
+};
+
+} // namespace detail
+
+// Resumes the coroutine on a worker at the task's current priority
+inline auto switchToWorker(Jobs& jobs) noexcept { return detail::SwitchToWorkerAwaiter{jobs, std::nullopt}; }
+
+// Resumes the coroutine on a worker, and the task stays at 'priority' when it is resumed later
+inline auto switchToWorker(Jobs& jobs, JobPriority priority) noexcept { return detail::SwitchToWorkerAwaiter{jobs, priority}; }
+
+// Resumes the coroutine the next time the main thread calls Jobs::runMainThreadJobs()
+inline auto switchToMainThread(Jobs& jobs) noexcept
+{
+    struct Awaiter {
+        Jobs& jobs;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> coroutine) { jobs.executeOnMainThread([coroutine] { coroutine.resume(); }); }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{jobs};
+}
+
+} // namespace gc
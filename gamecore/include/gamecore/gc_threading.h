@@ -1,7 +1,32 @@
 #pragma once
 
+#include <vector>
+
 namespace gc {
 
 bool isMainThread();
 
+struct CPUCore {
+    std::vector<unsigned int> logical_cpus; // more than one when SMT (hyperthreading) is enabled
+    bool efficiency;                        // an E-core on a hybrid CPU, or a LITTLE core on ARM
+};
+
+/* The CPUs this process is allowed to run on, so an instance started with taskset or inside a cpuset only sees its own. */
+/* Without topology information from the OS every logical CPU is reported as its own performance core. */
+struct CPUTopology {
+    std::vector<CPUCore> cores; // performance cores first
+    unsigned int logical_cpu_count;
+    unsigned int performance_core_count;
+};
+
+/* Queried on first use */
+const CPUTopology& getCPUTopology();
+
+/* Logical CPUs in the order threads should be placed on them: */
+/* one per performance core, then one per efficiency core, then the remaining SMT siblings. */
+std::vector<unsigned int> getCPUPlacementOrder(const CPUTopology& topology);
+
+/* Restricts the calling thread to one logical CPU. Only implemented on Linux, returns false elsewhere or on failure. */
+bool pinCurrentThreadToCPU(unsigned int logical_cpu);
+
 } // namespace gc
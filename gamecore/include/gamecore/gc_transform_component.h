@@ -25,13 +25,22 @@ private:
     glm::quat m_rotation{1.0f, 0.0f, 0.0f, 0.0f};
     glm::vec3 m_scale{1.0f};
     Entity m_parent{ENTITY_NONE}; // set with TransformSystem::setParent()
+    // the parent's children form a doubly linked list through these, maintained by TransformSystem
+    Entity m_first_child{ENTITY_NONE};
+    Entity m_next_sibling{ENTITY_NONE};
+    Entity m_prev_sibling{ENTITY_NONE};
+    uint32_t m_hierarchy_index{}; // position in TransformSystem's flattened hierarchy
     glm::mat4 m_world_matrix{1.0f};
     bool m_dirty{true};
+    bool m_static{}; // set with TransformSystem::setStatic()
+    Name m_name{"entity"}; // set with TransformSystem::setName() so the name index is kept up to date
+    // positions in TransformSystem's name indices, so the entity can be removed from them without searching
+    uint32_t m_name_slot{};
+    uint32_t m_child_name_slot{};
 
 public:
-    Name name{"entity"};
+    Name getName() const { return m_name; }
 
-public:
     glm::vec3 getPosition() const { return m_position; }
 
     glm::quat getRotation() const { return m_rotation; }
@@ -44,6 +53,15 @@ public:
 
     Entity getParent() const { return m_parent; }
 
+    // Static entities are expected to rarely move and their parents must be static too.
+    // RenderSystem bakes their draws into batches that are only rebuilt when one is added or removed.
+    bool isStatic() const { return m_static; }
+
+    // Iterate children with: for (Entity c = t.getFirstChild(); c != ENTITY_NONE; c = getComponent<const TransformComponent>(c)->getNextSibling())
+    Entity getFirstChild() const { return m_first_child; }
+
+    Entity getNextSibling() const { return m_next_sibling; }
+
     TransformComponent& setPosition(const glm::vec3& position)
     {
         m_position = position;
@@ -91,11 +109,11 @@ public:
         // Entity handles cannot be serialised
         s.write(reinterpret_cast<const char*>(&parent), sizeof(uint32_t));
 
-        const uint32_t name_hash = name.getHash();
+        const uint32_t name_hash = m_name.getHash();
         s.write(reinterpret_cast<const char*>(&name_hash), sizeof(uint32_t));
     }
 
-    // returned TransformComponent's m_parent is always ENTITY_NONE
+    // returned TransformComponent's m_parent and sibling links are always ENTITY_NONE
     static TransformComponent deserialize(std::istream& s, uint32_t& parent_out)
     {
         TransformComponent t{};
@@ -117,7 +135,7 @@ public:
 
         uint32_t name_hash{};
         s.read(reinterpret_cast<char*>(&name_hash), sizeof(uint32_t));
-        t.name = Name(name_hash);
+        t.m_name = Name(name_hash);
 
         return t;
     }
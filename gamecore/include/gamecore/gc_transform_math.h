@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace gc {
+
+// Returns translation * rotation * scale. Gives the same result as glm::scale(glm::mat4_cast(rotation), scale) with the translation set,
+// without building the intermediate matrices.
+glm::mat4 composeTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+// Returns parent * local where both have a bottom row of (0, 0, 0, 1), which saves a quarter of the work of a full 4x4 multiply
+glm::mat4 multiplyAffine(const glm::mat4& parent, const glm::mat4& local);
+
+} // namespace gc
@@ -1,24 +1,72 @@
 #pragma once
 
+#include <cstdint>
+
+#include <limits>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <span>
 
-#include <glm/mat4x4.hpp>
-
 #include "gamecore/gc_ecs.h"
 #include "gamecore/gc_name.h"
 
 namespace gc {
 
-class World; // forward-dec
+class World;              // forward-dec
+class TransformComponent; // forward-dec
 
 class TransformSystem : public System {
 public:
     static constexpr auto NAME = Name::createConstexpr("TransformSystem");
 
 private:
-    std::unordered_map<Entity, std::vector<Entity>> m_parent_children{};
+    static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+    // Batches smaller than this aren't worth sending to the job system
+    static constexpr uint32_t MIN_BATCH_SIZE = 1024;
+
+    struct HierarchyNode {
+        Entity entity;         // ENTITY_NONE for a tombstone left by a destroyed or moved entity
+        uint32_t parent_index; // index into m_hierarchy or NO_PARENT
+        uint32_t subtree_end;  // one past the node's last descendant, only valid for sorted nodes
+    };
+
+    // A range of m_hierarchy made up of whole subtrees whose roots are dirty
+    struct HierarchyRange {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // Every entity in depth-first order so parents always come before their children and each subtree is contiguous.
+    // Only the subtrees of dirty transforms are swept. Nodes appended since the last rebuild (from m_sorted_count on)
+    // still come after their parents but aren't part of their parent's subtree range, so they are always swept.
+    // Destroyed entities leave tombstones which are skipped, and reparented subtrees are tombstoned and appended again.
+    // Tombstones are removed by compactHierarchy() once there are enough of them.
+    std::vector<HierarchyNode> m_hierarchy{};
+    uint32_t m_sorted_count{};
+    uint32_t m_tombstone_count{};
+    std::vector<Entity> m_moved_subtree{}; // scratch for setParent()
+
+    // Scratch for onUpdate() and updateWorldMatrices()
+    std::vector<uint32_t> m_node_update_ticks{}; // change tick when each node's world matrix was last recomputed
+    std::vector<uint32_t> m_dirty_nodes{};
+    std::vector<HierarchyRange> m_dirty_ranges{};
+    std::vector<HierarchyRange> m_batches{}; // ranges of m_dirty_ranges given to each job
+
+    uint32_t m_last_update_tick{};
+
+    // The entities sharing a key in a name index, in the order they were added. Removed entities leave ENTITY_NONE behind
+    // so the rest keep their slots (TransformComponent::m_name_slot and m_child_name_slot) until half of the list is gaps.
+    struct NameIndexEntry {
+        std::vector<Entity> entities{};
+        uint32_t first{}; // slot of the earliest entity still in the list
+        uint32_t count{}; // entities that aren't gaps
+    };
+
+    // Every entity is in both name indices. Names don't have to be unique.
+    std::unordered_map<Name, NameIndexEntry> m_name_index{};
+    std::unordered_map<uint64_t, NameIndexEntry> m_child_name_index{}; // key is from getChildKey()
 
 public:
     TransformSystem(gc::World& world);
@@ -31,19 +79,66 @@ public:
      */
     void setParent(Entity entity, Entity parent);
 
-    /* gets a non-owning list of children of an entity, only guaranteed to be valid until the TransformSystem is next updated */
-    std::span<const Entity> getChildren(Entity parent) const
-    {
-        if (auto it = m_parent_children.find(parent); it != m_parent_children.end()) {
-            return it->second;
-        }
-        else {
-            return {};
-        }
-    }
+    // Marks the entity and all of its descendants as static (see TransformComponent::isStatic()) or not.
+    // Only roots and children of static entities can be made static, and a static entity can only be parented to a static entity.
+    void setStatic(Entity root, bool is_static);
+
+    // Renames an entity. TransformComponent's name can only be changed through here so the name indices stay up to date.
+    void setName(Entity entity, Name name);
+
+    // Only called by World::createEntity(), World::createEntities() and World::destroySubtree(). The parents version parents entities[i] to parents[i].
+    void onEntityCreated(Entity entity, Name name, Entity parent);
+    void onEntitiesCreated(std::span<const Entity> entities, Name name, Entity parent);
+    void onEntitiesCreated(std::span<const Entity> entities, Name name, std::span<const Entity> parents);
+    // 'entities' must come from getSubtree(root). Unlinks root from its parent and removes every entity from the name indices.
+    // Takes time linear in the size of the subtree.
+    void onSubtreeDestroyed(Entity root, std::span<const Entity> entities);
+
+    // Appends root and all of its descendants to 'out' in depth-first order (parents before children).
+    // Defined for std::vector and FrameVector.
+    template <typename Allocator>
+    void getSubtree(Entity root, std::vector<Entity, Allocator>& out) const;
+
+    // Reserves space in the name indices for this many more entities
+    void reserve(uint32_t count);
+
+    // Returns the entity with the given name or ENTITY_NONE if there is none. Takes constant time.
+    // If several entities share the name, the one that has had it the longest is returned.
+    Entity findEntity(Name name) const;
+
+    // Returns the child of parent with the given name or ENTITY_NONE if there is none. If parent is ENTITY_NONE, root entities are searched.
+    // If several children share the name, the one that has had it under this parent the longest is returned.
+    Entity findChild(Entity parent, Name name) const;
+
+    // Follows a path of names separated by '/' such as "root/arm/hand", starting from the children of 'root' (root entities if ENTITY_NONE).
+    // Returns ENTITY_NONE if any part of the path isn't found.
+    Entity findEntityByPath(std::string_view path, Entity root = ENTITY_NONE) const;
 
 private:
-    void updateWorldMatricesRecursively(Entity entity, const glm::mat4& parent_matrix = glm::mat4{1.0f});
+    static uint64_t getChildKey(Entity parent, Name name) { return (static_cast<uint64_t>(parent) << 32) | name.getHash(); }
+
+    // True if parent is ENTITY_NONE or static, so a static child's world matrix never changes because of it
+    bool isStaticOrRoot(Entity parent) const;
+
+    // Pushes the entity to the front of parent's list of children and sets t.m_parent. Does nothing else if parent is ENTITY_NONE.
+    void linkToParent(Entity entity, TransformComponent& t, Entity parent);
+
+    // Removes the entity from its parent's list of children in O(1). t.m_parent is left as it was.
+    void unlinkFromParent(TransformComponent& t);
+
+    // Adds a new entity to the end of m_hierarchy, its parent must already be in there
+    void appendToHierarchy(Entity entity, TransformComponent& t);
+
+    void rebuildHierarchy();
+
+    // Removes tombstones from m_hierarchy without changing the order of the remaining nodes
+    void compactHierarchy();
+
+    // Fills m_dirty_ranges with the subtrees of dirty sorted nodes and groups them into m_batches
+    void findDirtyRanges();
+
+    // Updates nodes [begin, end) of m_hierarchy. Returns true if any world matrix was recomputed.
+    bool updateWorldMatrices(uint32_t begin, uint32_t end, uint32_t change_tick);
 };
 
 } // namespace gc
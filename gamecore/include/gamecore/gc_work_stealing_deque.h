@@ -0,0 +1,135 @@
+#pragma once
+
+// A lock-free Chase-Lev work-stealing deque.
+// The owning thread pushes and pops at the bottom (LIFO), any other thread may steal from the top (FIFO).
+// Based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli, 2013).
+// The deque grows when full. Old arrays are kept until the deque is destroyed since a thief may still be reading them.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace gc {
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier, which is what m_top and m_bottom are aligned for
+#endif
+
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque elements are copied with relaxed atomics, store pointers or handles");
+
+    class Array {
+        const int64_t m_capacity;
+        const int64_t m_mask;
+        std::unique_ptr<std::atomic<T>[]> m_data;
+
+    public:
+        explicit Array(int64_t capacity) : m_capacity(capacity), m_mask(capacity - 1), m_data(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+        int64_t capacity() const { return m_capacity; }
+        T get(int64_t index) const { return m_data[index & m_mask].load(std::memory_order_relaxed); }
+        void put(int64_t index, T item) { m_data[index & m_mask].store(item, std::memory_order_relaxed); }
+    };
+
+    // top and bottom are written by different threads so keep them on separate cache lines
+    alignas(64) std::atomic<int64_t> m_top{0};
+    alignas(64) std::atomic<int64_t> m_bottom{0};
+    std::atomic<Array*> m_array;
+    std::vector<std::unique_ptr<Array>> m_arrays{}; // owner thread only, the current array is always the last
+
+public:
+    // capacity must be a power of two
+    explicit WorkStealingDeque(int64_t initial_capacity = 256)
+    {
+        m_arrays.push_back(std::make_unique<Array>(initial_capacity));
+        m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner thread only
+    void push(T item)
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        Array* array = m_array.load(std::memory_order_relaxed);
+        if (bottom - top > array->capacity() - 1) {
+            array = grow(array, bottom, top);
+        }
+        array->put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // Owner thread only. Returns the most recently pushed item.
+    std::optional<T> pop()
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Array* const array = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        std::optional<T> result{};
+        if (top <= bottom) {
+            result = array->get(bottom);
+            if (top == bottom) {
+                // last item, race against thieves for it
+                if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    result.reset();
+                }
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+        }
+        else {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    // Any thread. Returns the oldest item. May spuriously return nothing if it loses a race with another thread.
+    std::optional<T> steal()
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top < bottom) {
+            const T item = m_array.load(std::memory_order_acquire)->get(top);
+            if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return item;
+            }
+        }
+        return {};
+    }
+
+    // Only a hint when called from a thread other than the owner
+    bool empty() const { return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed); }
+
+private:
+    Array* grow(Array* array, int64_t bottom, int64_t top)
+    {
+        auto new_array = std::make_unique<Array>(array->capacity() * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            new_array->put(i, array->get(i));
+        }
+        m_arrays.push_back(std::move(new_array));
+        m_array.store(m_arrays.back().get(), std::memory_order_release);
+        return m_arrays.back().get();
+    }
+};
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+} // namespace gc
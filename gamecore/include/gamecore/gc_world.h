@@ -1,13 +1,27 @@
 #pragma once
 
 #include "gamecore/gc_ecs.h"
+#include "gamecore/gc_archetype.h"
 #include "gamecore/gc_abort.h"
 #include "gamecore/gc_assert.h"
 #include "gamecore/gc_name.h"
 #include "gamecore/gc_frame_state.h"
-
+#include "gamecore/gc_jobs.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <vector>
 #include <memory>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -16,24 +30,128 @@
 
 namespace gc {
 
+template <ValidComponent... Ts>
+class Query; // forward-dec
+
+class WorldCommandBuffer; // forward-dec
+
 class World {
+    template <ValidComponent...>
+    friend class Query;
+    friend class WorldCommandBuffer;
+
     struct ComponentArrayEntry {
-        std::unique_ptr<IComponentArray> component_array;
+        std::unique_ptr<IComponentArray> component_array; // nullptr if type is ComponentArrayType::ARCHETYPE
         ComponentArrayType type;
+        uint32_t component_size;
+    };
+
+    // Where an entity's row is in m_archetypes
+    struct EntityLocation {
+        uint32_t archetype;
+        uint32_t row;
+    };
+
+    // Resolves where a component is stored for every entity in an archetype, so forEach() doesn't need to check signatures per entity.
+    // type says which of the other members are used. resolveFetchers() turns it into a TypedComponentFetcher before visiting any rows.
+    template <ValidComponent T>
+    struct ComponentFetcher {
+        ComponentArrayType type;
+        T* column;              // only used for ComponentArrayType::ARCHETYPE
+        uint32_t* column_ticks; // only used for ComponentArrayType::ARCHETYPE
+        IComponentArray* array; // only used for SPARSE/DENSE
+        uint32_t tick;
+    };
+
+    // A ComponentFetcher whose storage type is known at compile time, so get() doesn't branch on it for every entity.
+    // Unless T is const, get() also sets the component's change tick.
+    template <ValidComponent T, ComponentArrayType ArrayType>
+    struct TypedComponentFetcher {
+        T* column;
+        uint32_t* column_ticks;
+        IComponentArray* array;
+        uint32_t tick;
+
+        T& get(const Entity entity, const uint32_t row) const
+        {
+            if constexpr (ArrayType == ComponentArrayType::ARCHETYPE) {
+                if constexpr (!std::is_const_v<T>) {
+                    column_ticks[row] = tick;
+                }
+                return column[row];
+            }
+            else {
+                auto* const component_array = static_cast<ComponentArray<std::remove_const_t<T>, ArrayType>*>(array);
+                if constexpr (!std::is_const_v<T>) {
+                    component_array->setChangeTick(entity, tick);
+                }
+                return component_array->get(entity);
+            }
+        }
     };
 
     std::vector<ComponentArrayEntry> m_component_arrays{};
     std::vector<Signature> m_entity_signatures{};
+    std::vector<EntityLocation> m_entity_locations{};
     std::vector<Entity> m_free_entity_ids;
     std::vector<std::unique_ptr<System>> m_systems{};
 
+    // Every alive entity is in exactly one archetype. m_archetypes[0] is the archetype with an empty signature.
+    // unique_ptr so references to archetypes stay valid when new archetypes are created.
+    std::vector<std::unique_ptr<Archetype>> m_archetypes{};
+    std::unordered_map<Signature, uint32_t> m_archetype_lookup{};
+
+    // Archetypes that match a query's signature. Kept up to date as archetypes are created.
+    struct QueryState {
+        Signature required;
+        std::vector<Archetype*> archetypes;
+    };
+
+    // unique_ptr so Query objects can keep pointers to their state
+    std::vector<std::unique_ptr<QueryState>> m_queries{};
+    std::unordered_map<Signature, uint32_t> m_query_lookup{};
+
     std::vector<Name> m_component_names{};
     std::vector<Name> m_system_names{};
 
-    Entity m_max_alive_entity_id{};
+    // std::nullopt for systems registered without a SystemAccess
+    std::vector<std::optional<SystemAccess>> m_system_accesses{};
+
+    // Systems grouped into stages that run one after the other. Systems within a stage don't conflict with each other.
+    // Rebuilt at the start of update() when systems have been registered.
+    std::vector<std::vector<uint32_t>> m_system_stages{};
+    bool m_system_stages_dirty{};
+    std::vector<JobHandle> m_system_job_handles{}; // systems of the current stage running on workers
+
+    Jobs& m_jobs;
+
+    // One command buffer per thread that has called commands(), plus buffers given to submitCommands().
+    // The mutex guards both vectors. Recording into the per-thread buffers isn't locked, see commands().
+    const uint64_t m_id; // identifies this World in commands()'s thread-local cache
+    std::vector<std::pair<std::thread::id, std::unique_ptr<WorldCommandBuffer>>> m_command_buffers{};
+    std::vector<std::unique_ptr<WorldCommandBuffer>> m_submitted_command_buffers{};
+    std::mutex m_command_buffers_mutex{};
+    std::atomic<bool> m_running_systems{}; // while a stage of systems runs in update(), commands() may be called from workers
+    bool m_flushing_commands{};           // only used on the main thread
+    // Scratch for flushCommands()
+    std::vector<std::unique_ptr<WorldCommandBuffer>> m_applying_command_buffers{};
+    std::vector<WorldCommandBuffer*> m_flushing_command_buffers{};
+
+    // Incremented after each stage of systems in update(). Components record the tick when they were last accessed mutably.
+    uint32_t m_change_tick{1};
+    // Tick when each component was last removed from an entity (including when entities are deleted)
+    std::array<uint32_t, MAX_COMPONENTS> m_removal_ticks{};
+    // Entities each component was removed from during this frame and the last one, with the tick of the removal. See forEachRemoved().
+    std::array<std::vector<std::pair<Entity, uint32_t>>, MAX_COMPONENTS> m_removed_entities{};
+    uint32_t m_removal_log_start_tick{}; // removals before this tick have been dropped from m_removed_entities
+    uint32_t m_frame_start_tick{};
+
+    // Entities cannot be created/deleted and components cannot be added/removed while iterating.
+    // Atomic since systems running concurrently can iterate at the same time.
+    std::atomic<uint32_t> m_iteration_depth{};
 
 public:
-    World();
+    explicit World(Jobs& jobs);
     World(const World&) = delete;
 
     ~World();
@@ -42,14 +160,64 @@ public:
 
     void update(FrameState& frame_state);
 
+    // The job system that multi-system stages run on. Systems registered with SystemAccess::onMainThread() may dispatch to it and wait.
+    Jobs& getJobs() { return m_jobs; }
+
     Entity createEntity(Name name, Entity parent = ENTITY_NONE, const glm::vec3& position = glm::vec3{0.0f, 0.0f, 0.0f},
                         const glm::quat& rotation = glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, const glm::vec3& scale = glm::vec3{1.0f, 1.0f, 1.0f});
 
-    void deleteEntity(Entity entity);
+    // Creates 'count' entities with the same name, parent and transform.
+    // Storage is reserved once up front and the entities are added to the TransformSystem's hierarchy in one go.
+    std::vector<Entity> createEntities(uint32_t count, Name name, Entity parent = ENTITY_NONE, const glm::vec3& position = glm::vec3{0.0f, 0.0f, 0.0f},
+                                       const glm::quat& rotation = glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, const glm::vec3& scale = glm::vec3{1.0f, 1.0f, 1.0f});
+
+    // Same as above but creates one entity for each parent, e.g. the same child in every copy of a prefab
+    std::vector<Entity> createEntities(std::span<const Entity> parents, Name name, const glm::vec3& position = glm::vec3{0.0f, 0.0f, 0.0f},
+                                       const glm::quat& rotation = glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, const glm::vec3& scale = glm::vec3{1.0f, 1.0f, 1.0f});
+
+    // Grows storage so 'count' more entities can be created without reallocating
+    void reserveEntities(uint32_t count);
+
+    // Grows T's storage so 'count' more T can be added to entities up to highest_entity without reallocating
+    template <ValidComponent T>
+    void reserveComponents(uint32_t count, Entity highest_entity)
+    {
+        reserveComponents(getComponentIndex<T>(), count, highest_entity);
+    }
+
+    // Deletes the entity and all of its descendants, same as destroySubtree()
+    void deleteEntity(Entity entity) { destroySubtree(entity); }
 
-    // returns ENTITY_NONE on failure
+    // Deletes root and every entity below it in the hierarchy. Takes time linear in the size of the subtree.
+    void destroySubtree(Entity root);
+
+    // Returns the entity with the given name, ENTITY_NONE on failure. Uses TransformSystem's name index.
+    // Names don't have to be unique, if several entities share one the one that has had it the longest is returned.
     Entity findEntity(Name name);
 
+    // Returns a child of parent (or a root entity if parent is ENTITY_NONE) with the given name, ENTITY_NONE on failure
+    Entity findChild(Entity parent, Name name);
+
+    // Looks up a path such as "root/arm/hand" starting at the children of 'root', ENTITY_NONE on failure
+    Entity findEntityByPath(std::string_view path, Entity root = ENTITY_NONE);
+
+    bool isAlive(Entity entity) const
+    {
+        return entity < static_cast<uint32_t>(m_entity_signatures.size()) && m_entity_signatures[entity].componentCount() != 0;
+    }
+
+    // Returns the WorldCommandBuffer for the calling thread. Safe to call from systems and jobs while iterating.
+    // Recording isn't locked, so this is only for the main thread, systems and the jobs they wait on during update(),
+    // and parallelForEach() callbacks, as nothing can flush while they run. Background jobs and Tasks record into their own buffer and pass it to submitCommands().
+    WorldCommandBuffer& commands();
+
+    // Queues a buffer to be applied by the next flushCommands(). Can be called from any thread at any time.
+    void submitCommands(WorldCommandBuffer&& command_buffer);
+
+    // Applies every thread's WorldCommandBuffer and every submitted buffer. Must be called on the main thread and not while iterating.
+    // update() calls this after each stage of systems.
+    void flushCommands();
+
     // Create a ComponentArray for the given component
     template <ValidComponent T, ComponentArrayType ArrayType>
     void registerComponent()
@@ -58,42 +226,70 @@ public:
         if (component_index != m_component_arrays.size()) {
             gc::abortGame("Attempt to register same component twice!");
         }
-        m_component_arrays.emplace_back(std::make_unique<ComponentArray<T, ArrayType>>(), ArrayType);
+        if constexpr (ArrayType == ComponentArrayType::ARCHETYPE) {
+            // Archetype columns are std::vector<std::byte> so the data is only aligned to what operator new gives
+            static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+            m_component_arrays.emplace_back(nullptr, ArrayType, static_cast<uint32_t>(sizeof(T)));
+        }
+        else {
+            m_component_arrays.emplace_back(std::make_unique<ComponentArray<T, ArrayType>>(), ArrayType, static_cast<uint32_t>(sizeof(T)));
+        }
         m_component_names.push_back(T::NAME);
     }
 
     // The returned reference can be invalidated when addComponent() is called again for the same component type.
+    // For sparse components, it can also be invalidated by removeComponent() for the same component type.
+    // For archetype components, it is also invalidated when any component is added to or removed from an entity.
     template <ValidComponent T>
     T& addComponent(const Entity entity)
     {
+        static_assert(!std::is_const_v<T>);
         GC_ASSERT(entity != ENTITY_NONE);
+        GC_ASSERT(m_iteration_depth == 0 && "Cannot add components while iterating!");
 
         const uint32_t component_index = getComponentIndex<T>();
 
         GC_ASSERT(entity < static_cast<uint32_t>(m_entity_signatures.size()));
         GC_ASSERT(!m_entity_signatures[entity].hasComponentIndex(component_index) && "Component already exists!");
-
-        m_entity_signatures[entity].setWithIndex(component_index);
-
         GC_ASSERT(component_index < static_cast<uint32_t>(m_component_arrays.size()));
-        GC_ASSERT(m_component_arrays[component_index].component_array);
 
-        m_component_arrays[component_index].component_array->addComponent(entity);
+        moveEntityToArchetype(entity, getArchetypeTransition(m_entity_locations[entity].archetype, component_index, true));
 
-        if (m_component_arrays[component_index].type == ComponentArrayType::SPARSE) {
-            auto& component_array = static_cast<ComponentArray<T, ComponentArrayType::SPARSE>&>(*(m_component_arrays[component_index].component_array));
+        m_entity_signatures[entity].setWithIndex(component_index);
+
+        auto& component_array_entry = m_component_arrays[component_index];
+        switch (component_array_entry.type) {
+        case ComponentArrayType::ARCHETYPE: {
+            const EntityLocation location = m_entity_locations[entity];
+            Archetype& archetype = *m_archetypes[location.archetype];
+            archetype.setChangeTick(component_index, location.row, m_change_tick);
+            archetype.setMaxChangeTick(component_index, m_change_tick);
+            return *std::construct_at(static_cast<T*>(archetype.getComponentData(component_index, location.row)));
+        }
+        case ComponentArrayType::SPARSE: {
+            GC_ASSERT(component_array_entry.component_array);
+            auto& component_array = static_cast<ComponentArray<T, ComponentArrayType::SPARSE>&>(*(component_array_entry.component_array));
+            component_array.addComponent(entity);
+            component_array.setChangeTick(entity, m_change_tick);
+            component_array.setMaxChangeTick(m_change_tick);
             return component_array.get(entity);
         }
-        else {
-            auto& component_array = static_cast<ComponentArray<T, ComponentArrayType::DENSE>&>(*(m_component_arrays[component_index].component_array));
+        default: {
+            GC_ASSERT(component_array_entry.component_array);
+            auto& component_array = static_cast<ComponentArray<T, ComponentArrayType::DENSE>&>(*(component_array_entry.component_array));
+            component_array.addComponent(entity);
+            component_array.setChangeTick(entity, m_change_tick);
+            component_array.setMaxChangeTick(m_change_tick);
             return component_array.get(entity);
         }
+        }
     }
 
     template <ValidComponent T>
     void removeComponent(const Entity entity)
     {
         GC_ASSERT(entity != ENTITY_NONE);
+        GC_ASSERT(m_iteration_depth == 0 && "Cannot remove components while iterating!");
 
         const uint32_t component_index = getComponentIndex<T>();
 
@@ -102,17 +298,25 @@ public:
                   "Attempt to remove component from entity. But component didn't exist in the first place!");
 
         m_entity_signatures[entity].setWithIndex(component_index, false);
+        recordRemoval(component_index, entity);
 
         GC_ASSERT(component_index < static_cast<uint32_t>(m_component_arrays.size()));
-        GC_ASSERT(m_component_arrays[component_index].component_array);
 
-        m_component_arrays[component_index].component_array->removeComponent(entity);
+        // archetype components are dropped when the row is moved
+        moveEntityToArchetype(entity, getArchetypeTransition(m_entity_locations[entity].archetype, component_index, false));
+
+        if (m_component_arrays[component_index].component_array) {
+            m_component_arrays[component_index].component_array->removeComponent(entity);
+        }
     }
 
     // returns nullptr if component does not exist in entity
+    // Unless T is const, the component is marked as changed (see forEachChanged()). Use const T when only reading.
     template <ValidComponent T>
     T* getComponent(const Entity entity)
     {
+        using Component = std::remove_const_t<T>;
+
         if (entity == ENTITY_NONE) {
             return nullptr;
         }
@@ -126,31 +330,106 @@ public:
         }
         else {
             GC_ASSERT(component_index < static_cast<uint32_t>(m_component_arrays.size()));
-            GC_ASSERT(m_component_arrays[component_index].component_array);
 
             auto& component_array_entry = m_component_arrays[component_index];
-            if (component_array_entry.type == ComponentArrayType::SPARSE) {
-                auto& component_array = static_cast<ComponentArray<T, ComponentArrayType::SPARSE>&>(*(component_array_entry.component_array));
+            switch (component_array_entry.type) {
+            case ComponentArrayType::ARCHETYPE: {
+                const EntityLocation location = m_entity_locations[entity];
+                Archetype& archetype = *m_archetypes[location.archetype];
+                if constexpr (!std::is_const_v<T>) {
+                    archetype.setChangeTick(component_index, location.row, m_change_tick);
+                    archetype.setMaxChangeTick(component_index, m_change_tick);
+                }
+                return static_cast<T*>(archetype.getComponentData(component_index, location.row));
+            }
+            case ComponentArrayType::SPARSE: {
+                GC_ASSERT(component_array_entry.component_array);
+                auto& component_array = static_cast<ComponentArray<Component, ComponentArrayType::SPARSE>&>(*(component_array_entry.component_array));
+                if constexpr (!std::is_const_v<T>) {
+                    component_array.setChangeTick(entity, m_change_tick);
+                    component_array.setMaxChangeTick(m_change_tick);
+                }
                 return &component_array.get(entity);
             }
-            else {
-                auto& component_array = static_cast<ComponentArray<T, ComponentArrayType::DENSE>&>(*(component_array_entry.component_array));
+            default: {
+                GC_ASSERT(component_array_entry.component_array);
+                auto& component_array = static_cast<ComponentArray<Component, ComponentArrayType::DENSE>&>(*(component_array_entry.component_array));
+                if constexpr (!std::is_const_v<T>) {
+                    component_array.setChangeTick(entity, m_change_tick);
+                    component_array.setMaxChangeTick(m_change_tick);
+                }
                 return &component_array.get(entity);
             }
+            }
         }
     }
 
+    // The storage of a DENSE component, indexed by entity, for systems that walk components in their own order.
+    // Slots of entities without the component hold stale data. Nothing is marked as changed, use ComponentArray::setChangeTick().
+    template <ValidComponent T>
+    ComponentArray<T, ComponentArrayType::DENSE>& getDenseComponentArray()
+    {
+        const uint32_t component_index = getComponentIndex<T>();
+        GC_ASSERT(component_index < static_cast<uint32_t>(m_component_arrays.size()));
+        GC_ASSERT(m_component_arrays[component_index].type == ComponentArrayType::DENSE);
+        return static_cast<ComponentArray<T, ComponentArrayType::DENSE>&>(*m_component_arrays[component_index].component_array);
+    }
+
     std::vector<Name> getComponentList(Entity entity) const;
 
+    // Components accessed mutably now will have this change tick
+    uint32_t getChangeTick() const { return m_change_tick; }
+
+    // Change tick when T was last removed from any entity, including by deleteEntity().
+    // forEachChanged() can't report removals, so a system can compare this with the tick it last ran to find out if it needs to start again.
+    // forEachRemoved() says which entities were affected.
+    template <ValidComponent T>
+    uint32_t getRemovalTick() const
+    {
+        return m_removal_ticks[getComponentIndex<T>()];
+    }
+
+    /*
+     * Calls func(Entity) for every entity that T was removed from (including by deleteEntity()) with a change tick greater than since_tick.
+     * The entity may have been given T again or been reused since, and may be reported more than once.
+     * Only removals from this frame and the last one are kept, so this returns false without calling func when since_tick is older than that,
+     * e.g. the system didn't run last frame. The system then has to start again as it would with getRemovalTick().
+     */
+    template <ValidComponent T, typename Func>
+    [[nodiscard]] bool forEachRemoved(uint32_t since_tick, Func&& func)
+    {
+        if (since_tick + 1 < m_removal_log_start_tick) {
+            return false;
+        }
+
+        const uint32_t component_index = getComponentIndex<T>();
+        if (m_removal_ticks[component_index] <= since_tick) {
+            return true;
+        }
+
+        ++m_iteration_depth;
+        const std::vector<std::pair<Entity, uint32_t>>& removed = m_removed_entities[component_index];
+        // entries are in tick order so only the end of the log needs looking at
+        auto it = std::ranges::upper_bound(removed, since_tick, {}, &std::pair<Entity, uint32_t>::second);
+        for (; it != removed.end(); ++it) {
+            func(it->first);
+        }
+        --m_iteration_depth;
+        return true;
+    }
+
     template <ValidDerivedSystem T, typename... Args>
     void registerSystem(Args&&... args)
     {
-        const uint32_t system_index = getSystemIndex<T>();
-        if (system_index != m_systems.size()) {
-            gc::abortGame("Attempt to register same system twice!");
-        }
-        m_systems.push_back(std::make_unique<T>(*this, std::forward<Args>(args)...));
-        m_system_names.push_back(T::NAME);
+        registerSystemImpl<T>(std::nullopt, std::forward<Args>(args)...);
+    }
+
+    // Like registerSystem() but the system can run concurrently with other systems it doesn't conflict with.
+    // See SystemAccess. Systems registered with registerSystem() conflict with every other system.
+    template <ValidDerivedSystem T, typename... Args>
+    void registerSystemWithAccess(const SystemAccess& access, Args&&... args)
+    {
+        registerSystemImpl<T>(access, std::forward<Args>(args)...);
     }
 
     template <ValidDerivedSystem T>
@@ -162,18 +441,386 @@ public:
         return static_cast<T&>(*m_systems[system_index]);
     }
 
+    // Only archetypes containing all of Ts are visited, so the cost is proportional to the number of matching entities.
+    // Entities must not be created/deleted and components must not be added/removed inside func.
+    // Components are marked as changed (see forEachChanged()) unless their type is const, e.g. forEach<const TransformComponent>().
     template <ValidComponent... Ts, typename Func>
     void forEach(Func&& func)
     {
-        for (Entity entity = 0; entity <= m_max_alive_entity_id && entity < m_entity_signatures.size(); ++entity) {
-            // erased entities will have an empty signature so will be skipped over here.
-            if (m_entity_signatures[entity].hasTypes<Ts...>()) {
-                auto components = std::make_tuple(getComponent<Ts>(entity)...);
-                GC_ASSERT((... && std::get<Ts*>(components)));
-                std::apply([&](Ts*... comps) { func(entity, *comps...); }, components);
+        const Signature required = Signature::fromTypes<Ts...>();
+        ++m_iteration_depth;
+        for (const auto& archetype : m_archetypes) {
+            if (archetype->getEntityCount() == 0 || !archetype->getSignature().contains(required)) {
+                continue;
+            }
+            (markColumnChanged<Ts>(*archetype), ...);
+            forEachInArchetype<Ts...>(*archetype, func);
+        }
+        --m_iteration_depth;
+    }
+
+    // Returns a Query that keeps track of the archetypes containing all of Ts as new archetypes are created.
+    // Use this instead of forEach() for iteration that happens every frame, as archetypes that don't match are never looked at.
+    // Queries for the same Ts share their state. Must not be called while iterating.
+    template <ValidComponent... Ts>
+    Query<Ts...> query()
+    {
+        return Query<Ts...>(*this, getOrCreateQueryState(Signature::fromTypes<Ts...>()));
+    }
+
+    // Calls func(std::span<const Entity>, std::span<Ts>...) once for every non-empty archetype containing all of Ts.
+    // All Ts must be registered with ComponentArrayType::ARCHETYPE so that they are tightly packed.
+    // The same restrictions as forEach() apply. Every non-const component in the chunk is marked as changed.
+    template <ValidComponent... Ts, typename Func>
+    void forEachChunk(Func&& func)
+    {
+        const Signature required = Signature::fromTypes<Ts...>();
+        GC_ASSERT((... && (m_component_arrays[getComponentIndex<Ts>()].type == ComponentArrayType::ARCHETYPE)));
+        ++m_iteration_depth;
+        for (const auto& archetype : m_archetypes) {
+            if (archetype->getEntityCount() == 0 || !archetype->getSignature().contains(required)) {
+                continue;
+            }
+            (markAllChanged<Ts>(*archetype), ...);
+            func(archetype->getEntities(), archetype->template getColumn<Ts>()...);
+        }
+        --m_iteration_depth;
+    }
+
+    /*
+     * Same as forEach() but the matching entities are split into batches of up to 'grain' entities that are run on the job system.
+     * Returns once every entity has been visited. If there is only one batch, it is run on the calling thread.
+     * Can be called from inside a job or a system running on a worker: it only waits on its own batches and runs other jobs while waiting.
+     * Nothing is allocated per call: each job works out which archetype and rows its batch covers from its index.
+     * Contract for func (it is called concurrently from multiple threads):
+     *  - It may read and write the components passed to it.
+     *  - It may read (not write) other components with getComponent() as long as no other batch writes those components.
+     *  - It must not create or delete entities, add or remove components, register components or systems, or call TransformSystem::setParent().
+     *  - Anything else it captures must be thread safe.
+     */
+    template <ValidComponent... Ts, typename Func>
+    void parallelForEach(Jobs& jobs, Func&& func, uint32_t grain = 256)
+    {
+        GC_ASSERT(grain > 0);
+
+        const Signature required = Signature::fromTypes<Ts...>();
+        uint32_t batch_count = 0;
+        for (const auto& archetype : m_archetypes) {
+            if (!archetype->getSignature().contains(required)) {
+                continue;
+            }
+            const uint32_t count = archetype->getEntityCount();
+            if (count != 0) {
+                (markColumnChanged<Ts>(*archetype), ...);
+            }
+            batch_count += (count + grain - 1) / grain;
+        }
+
+        // There are few archetypes and they can't change while iterating, so walking them for each batch is cheaper than storing the batches
+        auto run_batch = [&](uint32_t batch_index) {
+            for (const auto& archetype : m_archetypes) {
+                if (!archetype->getSignature().contains(required)) {
+                    continue;
+                }
+                const uint32_t count = archetype->getEntityCount();
+                const uint32_t archetype_batch_count = (count + grain - 1) / grain;
+                if (batch_index >= archetype_batch_count) {
+                    batch_index -= archetype_batch_count;
+                    continue;
+                }
+                const uint32_t begin = batch_index * grain;
+                const uint32_t end = std::min(begin + grain, count);
+                const std::tuple<ComponentFetcher<Ts>...> fetchers{makeComponentFetcher<Ts>(*archetype)...};
+                const std::span<const Entity> entities = archetype->getEntities();
+                auto visit_rows = [&](const auto&... typed_fetchers) {
+                    for (uint32_t row = begin; row < end; ++row) {
+                        func(entities[row], typed_fetchers.get(entities[row], row)...);
+                    }
+                };
+                resolveFetchers(fetchers, visit_rows);
+                return;
+            }
+        };
+
+        ++m_iteration_depth;
+        if (batch_count == 1) {
+            run_batch(0);
+        }
+        else if (batch_count > 1) {
+            jobs.wait(jobs.dispatch(batch_count, 1, [&](JobDispatchArgs args) { run_batch(args.job_index); }));
+        }
+        --m_iteration_depth;
+    }
+
+    // Visits every T in its sparse set directly, without going through archetypes, so all elements are contiguous in memory.
+    // T must be registered with ComponentArrayType::SPARSE. The same restrictions as forEach() apply.
+    template <ValidComponent T, typename Func>
+    void forEachSparse(Func&& func)
+    {
+        const uint32_t component_index = getComponentIndex<T>();
+        GC_ASSERT(component_index < static_cast<uint32_t>(m_component_arrays.size()));
+        GC_ASSERT(m_component_arrays[component_index].type == ComponentArrayType::SPARSE);
+        auto& component_array =
+            static_cast<ComponentArray<std::remove_const_t<T>, ComponentArrayType::SPARSE>&>(*(m_component_arrays[component_index].component_array));
+        if constexpr (!std::is_const_v<T>) {
+            component_array.setAllChangeTicks(m_change_tick);
+        }
+        const std::span<const Entity> entities = component_array.getEntities();
+        const std::span<T> components = component_array.getComponents();
+        ++m_iteration_depth;
+        for (std::size_t i = 0; i < entities.size(); ++i) {
+            func(entities[i], components[i]);
+        }
+        --m_iteration_depth;
+    }
+
+    /*
+     * Calls func(Entity, const T&) for every T with a change tick greater than since_tick, meaning it was added or accessed mutably since then.
+     * A system can store getChangeTick() at the end of onUpdate() and pass it here next time to only see components changed since it last ran.
+     * Changes made by the system itself during that onUpdate() are not reported. Removed components are never reported, see forEachRemoved().
+     * Archetype columns and component arrays without any changes are skipped entirely. The same restrictions as forEach() apply.
+     */
+    template <ValidComponent T, typename Func>
+    void forEachChanged(uint32_t since_tick, Func&& func)
+    {
+        using Component = std::remove_const_t<T>;
+        const uint32_t component_index = getComponentIndex<T>();
+        GC_ASSERT(component_index < static_cast<uint32_t>(m_component_arrays.size()));
+        const ComponentArrayEntry& entry = m_component_arrays[component_index];
+
+        ++m_iteration_depth;
+        switch (entry.type) {
+        case ComponentArrayType::ARCHETYPE: {
+            for (const auto& archetype : m_archetypes) {
+                if (archetype->getEntityCount() == 0 || !archetype->hasColumn(component_index) || archetype->getMaxChangeTick(component_index) <= since_tick) {
+                    continue;
+                }
+                const std::span<const Entity> entities = archetype->getEntities();
+                const std::span<const Component> components = archetype->template getColumn<const Component>();
+                const std::span<const uint32_t> ticks = archetype->getChangeTicks(component_index);
+                for (uint32_t row = 0; row < static_cast<uint32_t>(entities.size()); ++row) {
+                    if (ticks[row] > since_tick) {
+                        func(entities[row], components[row]);
+                    }
+                }
+            }
+            break;
+        }
+        case ComponentArrayType::SPARSE: {
+            auto& component_array = static_cast<ComponentArray<Component, ComponentArrayType::SPARSE>&>(*entry.component_array);
+            if (component_array.getMaxChangeTick() > since_tick) {
+                const std::span<const Entity> entities = component_array.getEntities();
+                const std::span<const Component> components = component_array.getComponents();
+                const std::span<const uint32_t> ticks = component_array.getChangeTicks();
+                forEachChangedBlock(component_array.getBlockChangeTicks(), ticks.size(), since_tick, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i) {
+                        if (ticks[i] > since_tick) {
+                            func(entities[i], components[i]);
+                        }
+                    }
+                });
+            }
+            break;
+        }
+        default: {
+            auto& component_array = static_cast<ComponentArray<Component, ComponentArrayType::DENSE>&>(*entry.component_array);
+            if (component_array.getMaxChangeTick() > since_tick) {
+                // dense arrays are indexed by entity and keep stale elements for entities without the component
+                const std::span<const uint32_t> ticks = component_array.getChangeTicks();
+                forEachChangedBlock(component_array.getBlockChangeTicks(), ticks.size(), since_tick, [&](std::size_t begin, std::size_t end) {
+                    for (auto entity = static_cast<Entity>(begin); entity < static_cast<Entity>(end); ++entity) {
+                        if (ticks[entity] > since_tick && m_entity_signatures[entity].hasComponentIndex(component_index)) {
+                            func(entity, std::as_const(component_array.get(entity)));
+                        }
+                    }
+                });
+            }
+            break;
+        }
+        }
+        --m_iteration_depth;
+    }
+
+private:
+    // Calls func(begin, end) for each range of element indices whose ComponentArray block tick is newer than since_tick
+    template <typename Func>
+    static void forEachChangedBlock(std::span<const uint32_t> block_ticks, std::size_t element_count, uint32_t since_tick, Func&& func)
+    {
+        constexpr std::size_t BLOCK_SIZE = IComponentArray::CHANGE_TICK_BLOCK_SIZE;
+        for (std::size_t block = 0; block * BLOCK_SIZE < element_count; ++block) {
+            if (block_ticks[block] > since_tick) {
+                func(block * BLOCK_SIZE, std::min((block + 1) * BLOCK_SIZE, element_count));
             }
         }
     }
+
+    template <ValidDerivedSystem T, typename... Args>
+    void registerSystemImpl(const std::optional<SystemAccess>& access, Args&&... args)
+    {
+        GC_ASSERT(m_iteration_depth == 0 && "Cannot register systems while systems are running concurrently!");
+        const uint32_t system_index = getSystemIndex<T>();
+        if (system_index != m_systems.size()) {
+            gc::abortGame("Attempt to register same system twice!");
+        }
+        m_systems.push_back(std::make_unique<T>(*this, std::forward<Args>(args)...));
+        m_system_names.push_back(T::NAME);
+        m_system_accesses.push_back(access);
+        m_system_stages_dirty = true;
+    }
+
+    void buildSystemStages();
+
+    // Allocates an entity ID and puts the entity in transform_archetype with a new TransformComponent.
+    // The entity still has to be added to the TransformSystem.
+    Entity createEntityWithTransform(uint32_t transform_archetype, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+    // Same for 'count' entities with storage reserved up front
+    std::vector<Entity> createEntitiesWithTransform(uint32_t count, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+    void recordRemoval(uint32_t component_index, Entity entity)
+    {
+        m_removal_ticks[component_index] = m_change_tick;
+        m_removed_entities[component_index].emplace_back(entity, m_change_tick);
+    }
+
+    // Used by WorldCommandBuffer to grow storage once before applying many commands
+    void reserveComponents(uint32_t component_index, uint32_t count, Entity highest_entity);
+
+    uint32_t getOrCreateArchetype(const Signature& signature);
+
+    // Returns the archetype that an entity in 'archetype' ends up in when the component is added or removed
+    uint32_t getArchetypeTransition(uint32_t archetype, uint32_t component_index, bool add);
+
+    void moveEntityToArchetype(Entity entity, uint32_t archetype);
+
+    void removeEntityFromArchetype(Entity entity);
+
+    const QueryState& getOrCreateQueryState(const Signature& required);
+
+    template <ValidComponent... Ts, typename Func>
+    void forEachInArchetype(Archetype& archetype, Func& func)
+    {
+        const std::tuple<ComponentFetcher<Ts>...> fetchers{makeComponentFetcher<Ts>(archetype)...};
+        const std::span<const Entity> entities = archetype.getEntities();
+        auto visit_rows = [&](const auto&... typed_fetchers) {
+            for (uint32_t row = 0; row < static_cast<uint32_t>(entities.size()); ++row) {
+                func(entities[row], typed_fetchers.get(entities[row], row)...);
+            }
+        };
+        resolveFetchers(fetchers, visit_rows);
+    }
+
+    // Calls func with every ComponentFetcher in 'fetchers' replaced by the TypedComponentFetcher for its storage type.
+    // func is instantiated for each combination of storage types, so the storage type is checked once per archetype instead of once per entity.
+    template <std::size_t I = 0, typename... Fetchers, typename Func, typename... TypedFetchers>
+    static void resolveFetchers(const std::tuple<Fetchers...>& fetchers, Func& func, const TypedFetchers&... typed_fetchers)
+    {
+        if constexpr (I == sizeof...(Fetchers)) {
+            func(typed_fetchers...);
+        }
+        else {
+            const auto& fetcher = std::get<I>(fetchers);
+            using T = std::remove_pointer_t<decltype(fetcher.column)>;
+            switch (fetcher.type) {
+            case ComponentArrayType::ARCHETYPE:
+                resolveFetchers<I + 1>(fetchers, func, typed_fetchers...,
+                                       TypedComponentFetcher<T, ComponentArrayType::ARCHETYPE>{fetcher.column, fetcher.column_ticks, nullptr, fetcher.tick});
+                break;
+            case ComponentArrayType::SPARSE:
+                resolveFetchers<I + 1>(fetchers, func, typed_fetchers...,
+                                       TypedComponentFetcher<T, ComponentArrayType::SPARSE>{nullptr, nullptr, fetcher.array, fetcher.tick});
+                break;
+            default:
+                resolveFetchers<I + 1>(fetchers, func, typed_fetchers...,
+                                       TypedComponentFetcher<T, ComponentArrayType::DENSE>{nullptr, nullptr, fetcher.array, fetcher.tick});
+                break;
+            }
+        }
+    }
+
+    template <ValidComponent T>
+    ComponentFetcher<T> makeComponentFetcher(Archetype& archetype)
+    {
+        const uint32_t component_index = getComponentIndex<T>();
+        GC_ASSERT(component_index < static_cast<uint32_t>(m_component_arrays.size()));
+        const ComponentArrayEntry& entry = m_component_arrays[component_index];
+        if (entry.type == ComponentArrayType::ARCHETYPE) {
+            return ComponentFetcher<T>{entry.type, archetype.template getColumn<T>().data(), archetype.getChangeTicks(component_index).data(), nullptr,
+                                       m_change_tick};
+        }
+        else {
+            return ComponentFetcher<T>{entry.type, nullptr, nullptr, entry.component_array.get(), m_change_tick};
+        }
+    }
+
+    // Sets the max change tick of T's storage before rows are visited with a ComponentFetcher. Does nothing if T is const.
+    // Must be called on the thread that owns the World, even if the rows are then visited by jobs.
+    template <ValidComponent T>
+    void markColumnChanged(Archetype& archetype)
+    {
+        if constexpr (!std::is_const_v<T>) {
+            const uint32_t component_index = getComponentIndex<T>();
+            const ComponentArrayEntry& entry = m_component_arrays[component_index];
+            switch (entry.type) {
+            case ComponentArrayType::ARCHETYPE:
+                archetype.setMaxChangeTick(component_index, m_change_tick);
+                break;
+            case ComponentArrayType::SPARSE:
+                static_cast<ComponentArray<T, ComponentArrayType::SPARSE>&>(*entry.component_array).setMaxChangeTick(m_change_tick);
+                break;
+            default:
+                static_cast<ComponentArray<T, ComponentArrayType::DENSE>&>(*entry.component_array).setMaxChangeTick(m_change_tick);
+                break;
+            }
+        }
+    }
+
+    // For forEachChunk(), T must use archetype storage
+    template <ValidComponent T>
+    void markAllChanged(Archetype& archetype)
+    {
+        if constexpr (!std::is_const_v<T>) {
+            archetype.setAllChangeTicks(getComponentIndex<T>(), m_change_tick);
+        }
+    }
+};
+
+/*
+ * A cached forEach(). Obtained from World::query() and cheap to copy.
+ * Iteration visits only the archetypes that contain all of Ts so the cost is proportional to the number of matching entities.
+ * The same restrictions as World::forEach() apply.
+ */
+template <ValidComponent... Ts>
+class Query {
+    friend class World;
+
+    World* m_world;
+    const World::QueryState* m_state;
+
+    Query(World& world, const World::QueryState& state) : m_world(&world), m_state(&state) {}
+
+public:
+    template <typename Func>
+    void forEach(Func&& func) const
+    {
+        ++m_world->m_iteration_depth;
+        for (Archetype* archetype : m_state->archetypes) {
+            if (archetype->getEntityCount() != 0) {
+                (m_world->template markColumnChanged<Ts>(*archetype), ...);
+                m_world->template forEachInArchetype<Ts...>(*archetype, func);
+            }
+        }
+        --m_world->m_iteration_depth;
+    }
+
+    // Number of entities that currently match
+    uint32_t count() const
+    {
+        uint32_t total = 0;
+        for (const Archetype* archetype : m_state->archetypes) {
+            total += archetype->getEntityCount();
+        }
+        return total;
+    }
 };
 
 } // namespace gc
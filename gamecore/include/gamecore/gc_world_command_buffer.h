@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <atomic>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "gamecore/gc_ecs.h"
+#include "gamecore/gc_assert.h"
+#include "gamecore/gc_name.h"
+#include "gamecore/gc_world.h"
+
+namespace gc {
+
+/*
+ * Records structural changes to the World (creating/deleting entities, adding/removing components) to be made later at a sync point.
+ * World::commands() returns the buffer for the calling thread, so systems and jobs can record commands while iterating.
+ * Background jobs and Tasks, which can run while the World is flushing, create their own buffer and hand it over with World::submitCommands().
+ * World::update() applies all buffers after each stage of systems. World::flushCommands() does the same on demand.
+ * Commands are not applied in the order they were recorded but in phases. Each phase is run for every buffer before the next one starts:
+ *  1. Entities are created, in recording order so parents are created before their children.
+ *  2. Components are added, grouped by component type.
+ *  3. Components are removed, grouped by component type.
+ *  4. Entities are deleted.
+ * Deleting last means an entity ID freed by one buffer can't be handed to an entity created by another buffer in the same flush.
+ * Entities returned by createEntity() are placeholders that are only understood by this buffer.
+ * They can be passed to this buffer's other methods (including as a parent) but not to the World or to another buffer.
+ * Each placeholder carries an ID of the buffer that made it, and applying a buffer asserts that its placeholders are its own.
+ * Commands for entities that have already been deleted when the buffer is applied are skipped. Entities have no generation,
+ * so this only holds if the ID hasn't been reused in the meantime: don't keep an entity across frames after it may have been deleted.
+ */
+class WorldCommandBuffer {
+    // A placeholder is PENDING_ENTITY_BIT, then the buffer's ID, then an index into m_creates
+    static constexpr Entity PENDING_ENTITY_BIT = 0x8000'0000;
+    static constexpr uint32_t PENDING_BUFFER_ID_SHIFT = 24;
+    static constexpr Entity PENDING_BUFFER_ID_MASK = 0x7F00'0000;
+    static constexpr Entity PENDING_INDEX_MASK = 0x00FF'FFFF;
+
+    // IDs wrap around after 128 buffers so a placeholder from another buffer is caught unless that many were created in between
+    inline static std::atomic<uint32_t> s_next_buffer_id{};
+
+    using ComponentCommandFunc = void (*)(World& world, Entity entity, const std::byte* data);
+
+    struct CreateCommand {
+        Name name;
+        Entity parent;
+        glm::vec3 position;
+        glm::quat rotation;
+        glm::vec3 scale;
+    };
+
+    struct ComponentCommand {
+        Entity entity;
+        uint32_t component_index;
+        uint32_t data_offset; // into m_component_data, only used for adds
+        ComponentCommandFunc func;
+    };
+
+    std::vector<CreateCommand> m_creates{};
+    std::vector<ComponentCommand> m_adds{};
+    std::vector<ComponentCommand> m_removes{};
+    std::vector<Entity> m_deletes{};
+    std::vector<std::byte> m_component_data{}; // copies of components passed to addComponent()
+    std::vector<Entity> m_created_entities{};  // placeholder index -> real entity, filled by applyCreates()
+    uint32_t m_buffer_id = s_next_buffer_id.fetch_add(1, std::memory_order_relaxed) & (PENDING_BUFFER_ID_MASK >> PENDING_BUFFER_ID_SHIFT);
+
+    Entity resolve(Entity entity) const;
+
+    // The phases of apply(). World::flushCommands() runs each one for every buffer before starting the next.
+    void applyCreates(World& world);
+    void applyComponentCommands(World& world, std::vector<ComponentCommand>& commands, bool add);
+    void applyAdds(World& world) { applyComponentCommands(world, m_adds, true); }
+    void applyRemoves(World& world) { applyComponentCommands(world, m_removes, false); }
+    void applyDeletes(World& world);
+
+    friend class World;
+
+public:
+    WorldCommandBuffer() = default;
+    WorldCommandBuffer(const WorldCommandBuffer&) = delete;
+    WorldCommandBuffer(WorldCommandBuffer&&) = default;
+
+    WorldCommandBuffer& operator=(const WorldCommandBuffer&) = delete;
+    WorldCommandBuffer& operator=(WorldCommandBuffer&&) = default;
+
+    // Returns a placeholder entity, see above
+    Entity createEntity(Name name, Entity parent = ENTITY_NONE, const glm::vec3& position = glm::vec3{0.0f, 0.0f, 0.0f},
+                        const glm::quat& rotation = glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, const glm::vec3& scale = glm::vec3{1.0f, 1.0f, 1.0f});
+
+    void deleteEntity(Entity entity)
+    {
+        GC_ASSERT(entity != ENTITY_NONE);
+        m_deletes.push_back(entity);
+    }
+
+    template <ValidComponent T>
+    void addComponent(Entity entity, const T& component = T{})
+    {
+        GC_ASSERT(entity != ENTITY_NONE);
+        const auto data_offset = static_cast<uint32_t>(m_component_data.size());
+        m_component_data.resize(m_component_data.size() + sizeof(T));
+        std::memcpy(m_component_data.data() + data_offset, &component, sizeof(T));
+        m_adds.emplace_back(entity, getComponentIndex<T>(), data_offset,
+                            [](World& world, Entity e, const std::byte* data) { std::memcpy(&world.addComponent<T>(e), data, sizeof(T)); });
+    }
+
+    template <ValidComponent T>
+    void removeComponent(Entity entity)
+    {
+        GC_ASSERT(entity != ENTITY_NONE);
+        m_removes.emplace_back(entity, getComponentIndex<T>(), 0u, [](World& world, Entity e, const std::byte*) { world.removeComponent<T>(e); });
+    }
+
+    bool empty() const { return m_creates.empty() && m_adds.empty() && m_removes.empty() && m_deletes.empty(); }
+
+    // Makes every recorded change to the world then clears the buffer. Must not be called while iterating.
+    // This only orders phases within this buffer, use World::flushCommands() to apply every thread's buffer.
+    void apply(World& world);
+
+    void clear();
+};
+
+} // namespace gc
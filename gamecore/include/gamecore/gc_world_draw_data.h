@@ -6,8 +6,14 @@
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 
+#include "gamecore/gc_name.h"
+
 namespace gc {
 
+// Parts of WorldDrawData that systems writing them should declare as exclusive resources (see SystemAccess)
+constexpr Name DRAW_DATA_CAMERA_RESOURCE = Name::createConstexpr("WorldDrawData::camera");
+constexpr Name DRAW_DATA_LIGHT_RESOURCE = Name::createConstexpr("WorldDrawData::light");
+
 class RenderMaterial; // forward-dec
 class RenderMesh;     // forward-dec
 class RenderTexture;  // forward-dec
@@ -25,12 +31,22 @@ struct WorldInstancedDrawEntry {
     RenderMaterial* material;
 };
 
+// Instanced draws that stay the same from frame to frame, such as level geometry that never moves.
+// The transforms are only uploaded to the GPU again when generation changes.
+struct StaticDrawBatches {
+    std::vector<WorldInstancedDrawEntry> entries{}; // transform_offset indexes into transforms
+    std::vector<glm::mat4> transforms{};
+    uint64_t generation{};
+};
+
 class WorldDrawData {
     std::vector<WorldDrawEntry> m_draw_entries{};
 
     std::vector<WorldInstancedDrawEntry> m_instanced_draw_entries{};
     std::vector<glm::mat4> m_instanced_draw_transforms{};
 
+    const StaticDrawBatches* m_static_draw_batches{}; // not owned, must outlive the frame
+
     glm::mat4 m_projection_matrix{};
     glm::mat4 m_view_matrix{};
     glm::vec3 m_light_pos{};
@@ -41,6 +57,7 @@ public:
         m_draw_entries.clear();
         m_instanced_draw_entries.clear();
         m_instanced_draw_transforms.clear();
+        m_static_draw_batches = nullptr;
     }
 
     void drawMesh(const glm::mat4& world_matrix, RenderMesh* const mesh, RenderMaterial* const material)
@@ -55,6 +72,8 @@ public:
         m_instanced_draw_transforms.insert(m_instanced_draw_transforms.end(), transforms.begin(), transforms.end());
     }
 
+    void setStaticDrawBatches(const StaticDrawBatches* static_draw_batches) { m_static_draw_batches = static_draw_batches; }
+
     void setProjectionMatrix(const glm::mat4& projection_matrix) { m_projection_matrix = projection_matrix; }
     void setViewMatrix(const glm::mat4& view_matrix) { m_view_matrix = view_matrix; }
     void setLightPos(const glm::vec3& light_pos) { m_light_pos = light_pos; }
@@ -62,6 +81,7 @@ public:
     const auto& getDrawEntries() const { return m_draw_entries; }
     const auto& getInstancedDrawEntries() const { return m_instanced_draw_entries; }
     const auto& getInstancedDrawTransforms() const { return m_instanced_draw_transforms; }
+    const StaticDrawBatches* getStaticDrawBatches() const { return m_static_draw_batches; }
 
     const auto& getProjectionMatrix() const { return m_projection_matrix; }
     const auto& getViewMatrix() const { return m_view_matrix; }
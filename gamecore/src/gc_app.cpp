@@ -1,5 +1,6 @@
 #include "gamecore/gc_app.h"
 
+#include <algorithm>
 #include <memory>
 #include <thread>
 #include <string>
@@ -27,6 +28,8 @@
 #include "gamecore/gc_resource_manager.h"
 #include "gamecore/gc_net.h"
 #include "gamecore/gc_net_ui.h"
+#include "gamecore/gc_jobs_ui.h"
+#include "gamecore/gc_frame_arena.h"
 
 namespace gc {
 
@@ -90,9 +93,23 @@ App::App(const AppInitOptions& options)
 
     /* SUBSYSTEM INITIALISATION */
 
-    m_jobs = std::make_unique<Jobs>(std::thread::hardware_concurrency());
+    {
+        const CPUTopology& topology = getCPUTopology();
+        GC_INFO("CPU: {} cores ({} performance), {} logical CPUs available", topology.cores.size(), topology.performance_core_count,
+                topology.logical_cpu_count);
+        unsigned int job_threads = options.job_threads;
+        if (job_threads == 0) {
+            // SMT siblings add little for the job system and the main thread needs a core of its own
+            job_threads = std::max(1u, static_cast<unsigned int>(topology.cores.size()) - 1);
+        }
+        if (options.pin_threads && !pinCurrentThreadToCPU(getCPUPlacementOrder(topology).front())) {
+            GC_WARN("Failed to pin the main thread");
+        }
+        m_jobs = std::make_unique<Jobs>(job_threads, options.pin_threads);
+        GC_INFO("Job system using {} workers", job_threads);
+    }
     m_content = std::make_unique<Content>(m_application_directory / "content", options.pak_files_override);
-    m_world = std::make_unique<World>();
+    m_world = std::make_unique<World>(*m_jobs);
     m_resource_manager = std::make_unique<ResourceManager>(*m_content);
     m_net = std::make_unique<Net>();
 
@@ -216,6 +233,7 @@ void App::run()
         }
 
         gclog::Logger::instance().incrementFrameNumber();
+        FrameArena::beginFrame();
 
         frame_state.delta_time = static_cast<double>(last_frame_time_ns) * 1e-9;
         delta_times[frame_state.frame_count % delta_times.size()] = frame_state.delta_time;
@@ -256,6 +274,9 @@ void App::run()
             }
         }
 
+        // resumes coroutines waiting in switchToMainThread() among other things
+        m_jobs->runMainThreadJobs();
+
         if (m_debug_ui) {
             m_debug_ui->newFrame();
         }
@@ -265,6 +286,7 @@ void App::run()
         if (m_debug_ui) {
             m_debug_ui->update(frame_state);
             renderNetUI(*m_net);
+            renderJobsUI(*m_jobs);
             m_debug_ui->render();
         }
 
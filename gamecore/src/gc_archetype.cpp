@@ -0,0 +1,91 @@
+#include "gamecore/gc_archetype.h"
+
+#include <cstring>
+
+#include <algorithm>
+
+namespace gc {
+
+Archetype::Archetype(const Signature& signature, std::span<const ArchetypeColumnInfo> columns) : m_signature(signature)
+{
+    GC_ASSERT(columns.size() < NO_COLUMN);
+
+    m_column_lookup.fill(NO_COLUMN);
+    m_add_edges.fill(ARCHETYPE_NONE);
+    m_remove_edges.fill(ARCHETYPE_NONE);
+
+    m_columns.reserve(columns.size());
+    for (const ArchetypeColumnInfo& info : columns) {
+        GC_ASSERT(m_signature.hasComponentIndex(info.component_index));
+        GC_ASSERT(info.component_size > 0);
+        m_column_lookup[info.component_index] = static_cast<uint8_t>(m_columns.size());
+        m_columns.emplace_back(info.component_index, info.component_size, std::vector<std::byte>{}, std::vector<uint32_t>{}, 0u);
+    }
+}
+
+void Archetype::reserve(uint32_t additional_rows)
+{
+    const std::size_t rows = m_entities.size() + additional_rows;
+    m_entities.reserve(rows);
+    for (Column& column : m_columns) {
+        column.data.reserve(rows * column.component_size);
+        column.change_ticks.reserve(rows);
+    }
+}
+
+uint32_t Archetype::addRow(Entity entity)
+{
+    GC_ASSERT(entity != ENTITY_NONE);
+
+    const auto row = static_cast<uint32_t>(m_entities.size());
+    m_entities.push_back(entity);
+    for (Column& column : m_columns) {
+        column.data.resize(column.data.size() + column.component_size);
+        column.change_ticks.push_back(0);
+    }
+    return row;
+}
+
+Entity Archetype::removeRow(uint32_t row)
+{
+    GC_ASSERT(row < m_entities.size());
+
+    const auto last_row = static_cast<uint32_t>(m_entities.size() - 1);
+    Entity moved_entity = ENTITY_NONE;
+    if (row != last_row) {
+        moved_entity = m_entities[last_row];
+        m_entities[row] = moved_entity;
+        for (Column& column : m_columns) {
+            std::memcpy(column.data.data() + static_cast<std::size_t>(row) * column.component_size,
+                        column.data.data() + static_cast<std::size_t>(last_row) * column.component_size, column.component_size);
+            column.change_ticks[row] = column.change_ticks[last_row];
+        }
+    }
+    m_entities.pop_back();
+    for (Column& column : m_columns) {
+        column.data.resize(column.data.size() - column.component_size);
+        column.change_ticks.pop_back();
+    }
+    return moved_entity;
+}
+
+uint32_t Archetype::moveRow(uint32_t row, Archetype& destination, Entity& moved_entity)
+{
+    GC_ASSERT(row < m_entities.size());
+    GC_ASSERT(&destination != this);
+
+    const uint32_t destination_row = destination.addRow(m_entities[row]);
+    for (const Column& column : m_columns) {
+        if (destination.hasColumn(column.component_index)) {
+            std::memcpy(destination.getComponentData(column.component_index, destination_row),
+                        column.data.data() + static_cast<std::size_t>(row) * column.component_size, column.component_size);
+            const uint32_t tick = column.change_ticks[row];
+            destination.setChangeTick(column.component_index, destination_row, tick);
+            destination.setMaxChangeTick(column.component_index, std::max(destination.getMaxChangeTick(column.component_index), tick));
+        }
+    }
+    moved_entity = removeRow(row);
+    return destination_row;
+}
+
+} // namespace gc
@@ -21,6 +21,7 @@
 #include "gamecore/gc_frame_state.h"
 #include "gamecore/gc_content.h"
 #include "gamecore/gc_units.h"
+#include "gamecore/gc_frame_arena.h"
 
 namespace gc {
 
@@ -116,6 +117,7 @@ void DebugUI::update(FrameState& frame_state)
         ImGui::Begin("Debug UI", nullptr);
         ImGui::Text("Average frame time: %.3f ms (%d fps)", frame_state.average_frame_time * 1000.0,
                     static_cast<int>(std::round(1.0 / frame_state.average_frame_time)));
+        ImGui::Text("Main thread frame arena: %zu KiB", FrameArena::local().getBytesUsed() / 1024);
         ImGui::Checkbox("Disable world rendering", &m_clear_draw_data);
         ImGui::Checkbox("Show ImGui Demo", &m_show_demo);
         ImGui::End();
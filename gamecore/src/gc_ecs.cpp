@@ -1,6 +1,7 @@
 #include "gamecore/gc_ecs.h"
 
 #include <atomic>
+#include <algorithm>
 
 namespace gc {
 
@@ -8,6 +9,15 @@ std::atomic<uint32_t> g_next_component_index{};
 std::atomic<uint32_t> g_next_system_index{};
 std::atomic<uint32_t> g_next_frame_state_object_index{};
 
+bool SystemAccess::conflictsWith(const SystemAccess& other) const
+{
+    if (m_writes.intersects(other.m_writes) || m_writes.intersects(other.m_reads) || other.m_writes.intersects(m_reads)) {
+        return true;
+    }
+    return std::ranges::any_of(m_exclusive_resources,
+                               [&](Name resource) { return std::ranges::find(other.m_exclusive_resources, resource) != other.m_exclusive_resources.end(); });
+}
+
 System::System(World& world) : m_world(world) {}
 
 } // namespace gc
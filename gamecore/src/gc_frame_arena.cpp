@@ -0,0 +1,91 @@
+#include "gamecore/gc_frame_arena.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "gamecore/gc_abort.h"
+#include "gamecore/gc_threading.h"
+
+namespace gc {
+
+static std::atomic<uint64_t> s_current_frame{0};
+
+void* FrameArena::allocate(std::size_t size, std::size_t alignment)
+{
+    GC_ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    size = std::max(size, std::size_t{1});
+
+    while (m_block_index < m_blocks.size()) {
+        Block& block = m_blocks[m_block_index];
+        const auto base = reinterpret_cast<std::uintptr_t>(block.data.get());
+        const std::uintptr_t aligned = (base + m_offset + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+        const std::size_t end = (aligned - base) + size;
+        if (end <= block.size) {
+            m_bytes_used += end - m_offset;
+            m_offset = end;
+            return reinterpret_cast<void*>(aligned);
+        }
+        // doesn't fit, the rest of this block is wasted until the next reset
+        ++m_block_index;
+        m_offset = 0;
+    }
+
+    // alignment of new[] is only guaranteed up to __STDCPP_DEFAULT_NEW_ALIGNMENT__, leave room to align by hand
+    const std::size_t last_size = m_blocks.empty() ? 0 : m_blocks.back().size;
+    const std::size_t block_size = std::max({MIN_BLOCK_SIZE, last_size * 2, size + alignment});
+    m_blocks.push_back(Block{std::make_unique_for_overwrite<std::byte[]>(block_size), block_size});
+    m_block_index = m_blocks.size() - 1;
+    m_offset = 0;
+    return allocate(size, alignment);
+}
+
+void FrameArena::reset()
+{
+    if (m_blocks.size() > 1) {
+        std::size_t total_size = 0;
+        for (const Block& block : m_blocks) {
+            total_size += block.size;
+        }
+        m_blocks.clear();
+        m_blocks.push_back(Block{std::make_unique_for_overwrite<std::byte[]>(total_size), total_size});
+    }
+    m_block_index = 0;
+    m_offset = 0;
+    m_bytes_used = 0;
+    ++m_generation;
+}
+
+void FrameArena::resetIfNewFrame()
+{
+    const uint64_t current_frame = s_current_frame.load(std::memory_order_relaxed);
+    if (m_frame != current_frame) {
+        reset();
+        m_frame = current_frame;
+    }
+}
+
+void FrameArena::checkAllocation(uint64_t generation) const
+{
+    // Checked in release builds too, getting this wrong silently corrupts memory
+    if (this != &local()) {
+        abortGame("FrameAllocator used on a thread other than the one that created it");
+    }
+    if (generation != m_generation) {
+        abortGame("FrameAllocator used after its arena was reset, was a frame container kept past the end of its frame or job?");
+    }
+}
+
+FrameArena& FrameArena::local()
+{
+    static thread_local FrameArena t_arena{};
+    return t_arena;
+}
+
+void FrameArena::beginFrame()
+{
+    GC_ASSERT(isMainThread());
+    s_current_frame.fetch_add(1, std::memory_order_relaxed);
+    local().resetIfNewFrame();
+}
+
+} // namespace gc
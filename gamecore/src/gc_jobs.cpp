@@ -2,66 +2,326 @@
 
 #include <cmath>
 
-#include <functional>
+#include <bit>
+#include <chrono>
 #include <format>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GC_JOBS_HAVE_PAUSE
+#endif
 
 #include <tracy/Tracy.hpp>
 
 #include "gamecore/gc_assert.h"
+#include "gamecore/gc_frame_arena.h"
+#include "gamecore/gc_threading.h"
 #include "gclog/gclog.h"
 
 namespace gc {
 
-Jobs::Jobs(unsigned int num_threads)
+// Recycles objects so the job system doesn't touch the heap once warmed up. T needs a 'T* next' member to link free slots.
+// Each thread keeps a small cache of free slots which spills into, and refills from, a shared list in batches.
+// Jobs are usually created on one thread and freed on another so the batches flow back to whichever thread submits.
+template <typename T>
+class SlotPool {
+    static constexpr std::size_t BATCH_SIZE = 64;
+
+    struct Shared {
+        std::mutex mutex;
+        T* head = nullptr;
+        std::vector<std::unique_ptr<T[]>> blocks;
+    };
+
+    struct LocalCache {
+        T* head = nullptr;
+        std::size_t count = 0;
+
+        ~LocalCache()
+        {
+            if (count > 0) {
+                spill(*this, count);
+            }
+        }
+    };
+
+    // Never destroyed since threads may return their slots during static destruction
+    static Shared& shared()
+    {
+        static Shared* const s_shared = new Shared;
+        return *s_shared;
+    }
+
+    static LocalCache& localCache()
+    {
+        static thread_local LocalCache t_cache{};
+        return t_cache;
+    }
+
+    static void refill(LocalCache& cache)
+    {
+        Shared& shared = SlotPool::shared();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (!shared.head) {
+            auto block = std::make_unique<T[]>(BATCH_SIZE);
+            for (std::size_t i = 0; i < BATCH_SIZE - 1; ++i) {
+                block[i].next = &block[i + 1];
+            }
+            cache.head = &block[0];
+            cache.count = BATCH_SIZE;
+            shared.blocks.push_back(std::move(block));
+            return;
+        }
+        T* last = shared.head;
+        std::size_t count = 1;
+        while (count < BATCH_SIZE && last->next) {
+            last = last->next;
+            ++count;
+        }
+        cache.head = shared.head;
+        cache.count = count;
+        shared.head = last->next;
+        last->next = nullptr;
+    }
+
+    // Moves the first 'count' slots of the cache to the shared list
+    static void spill(LocalCache& cache, std::size_t count)
+    {
+        T* const first = cache.head;
+        T* last = first;
+        for (std::size_t i = 1; i < count; ++i) {
+            last = last->next;
+        }
+        cache.head = last->next;
+        cache.count -= count;
+
+        Shared& shared = SlotPool::shared();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        last->next = shared.head;
+        shared.head = first;
+    }
+
+public:
+    static T* acquire()
+    {
+        LocalCache& cache = localCache();
+        if (!cache.head) {
+            refill(cache);
+        }
+        T* const slot = cache.head;
+        cache.head = slot->next;
+        --cache.count;
+        slot->next = nullptr;
+        return slot;
+    }
+
+    static void release(T* slot)
+    {
+        LocalCache& cache = localCache();
+        slot->next = cache.head;
+        cache.head = slot;
+        ++cache.count;
+        if (cache.count >= BATCH_SIZE * 2) {
+            spill(cache, BATCH_SIZE);
+        }
+    }
+};
+
+struct JobHandle::Counter {
+    std::atomic<unsigned int> references; // the handle returned to the caller plus one per unfinished job
+    std::atomic<unsigned int> remaining;  // jobs that haven't finished
+
+    // jobs held back until every dependency has finished
+    std::atomic<std::size_t> dependencies_remaining;
+    Jobs::Job* held_first;
+    Jobs::Job* held_last;
+    unsigned int held_count;
+
+    std::mutex dependents_mutex;
+    std::vector<Counter*> dependents; // counters whose jobs are waiting for this one to reach zero
+    bool done;                        // guarded by dependents_mutex, no dependents can be added once set
+
+    // shared by every group of a dispatch
+    JobDispatchFunction dispatch_func;
+    unsigned int dispatch_job_count;
+    unsigned int dispatch_group_size;
+
+    Jobs* jobs;
+    JobPriority priority;
+
+    Counter* next; // SlotPool free list
+};
+
+struct Jobs::Job {
+    JobFunction func;
+    JobHandle::Counter* counter; // holds a reference
+    Job* next;                   // injection overflow list, jobs held by dependencies or SlotPool free list
+    int64_t queued_ns;           // when it was pushed, for the latency histogram
+};
+
+JobHandle::JobHandle(Counter* counter) : m_counter(counter) {}
+
+JobHandle::JobHandle(const JobHandle& other) : m_counter(other.m_counter)
+{
+    if (m_counter) {
+        m_counter->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+JobHandle::JobHandle(JobHandle&& other) noexcept : m_counter(std::exchange(other.m_counter, nullptr)) {}
+
+JobHandle::~JobHandle()
+{
+    if (m_counter) {
+        releaseReference(m_counter);
+    }
+}
+
+JobHandle& JobHandle::operator=(const JobHandle& other)
+{
+    if (other.m_counter) {
+        other.m_counter->references.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (m_counter) {
+        releaseReference(m_counter);
+    }
+    m_counter = other.m_counter;
+    return *this;
+}
+
+JobHandle& JobHandle::operator=(JobHandle&& other) noexcept
+{
+    if (this != &other) {
+        if (m_counter) {
+            releaseReference(m_counter);
+        }
+        m_counter = std::exchange(other.m_counter, nullptr);
+    }
+    return *this;
+}
+
+bool JobHandle::isDone() const { return !m_counter || m_counter->remaining.load(std::memory_order_acquire) == 0; }
+
+Jobs* JobHandle::getJobs() const { return m_counter ? m_counter->jobs : nullptr; }
+
+void JobHandle::releaseReference(Counter* counter)
+{
+    if (counter->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        counter->dispatch_func.reset();
+        SlotPool<Counter>::release(counter);
+    }
+}
+
+// Identifies the worker running on the current thread so jobs it submits can go on its own deque
+static thread_local const Jobs* t_worker_jobs = nullptr;
+static thread_local unsigned int t_worker_index = 0;
+
+// How many times an idle worker or a waiting thread polls for work before parking
+static constexpr unsigned int SPIN_COUNT = 1024;
+
+static int64_t nowNs() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+static std::size_t latencyBucket(int64_t latency_ns)
+{
+    const int64_t latency_us = latency_ns / 1000;
+    if (latency_us <= 0) {
+        return 0;
+    }
+    return std::min(static_cast<std::size_t>(std::bit_width(static_cast<uint64_t>(latency_us))), JOB_LATENCY_BUCKET_COUNT - 1);
+}
+
+static void cpuRelax()
+{
+#ifdef GC_JOBS_HAVE_PAUSE
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+bool Jobs::InjectionQueue::push(Job* first, Job* last)
+{
+    for (Job* job = first; job;) {
+        Job* const next = job->next;
+        if (!ring.tryPush(job)) {
+            // Full. The rest of the list is still linked so move it onto the overflow list in one go.
+            // Order doesn't matter since jobs that need to run in order use dependencies.
+            std::lock_guard<std::mutex> lock(overflow_mutex);
+            if (overflow_tail) {
+                overflow_tail->next = job;
+            }
+            else {
+                overflow_head = job;
+            }
+            overflow_tail = last;
+            overflowed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        job = next;
+    }
+    return true;
+}
+
+Jobs::Job* Jobs::InjectionQueue::pop()
+{
+    if (std::optional<Job*> job = ring.tryPop()) {
+        return *job;
+    }
+    if (overflowed.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(overflow_mutex);
+        if (Job* const job = overflow_head) {
+            overflow_head = job->next;
+            if (!overflow_head) {
+                overflow_tail = nullptr;
+                overflowed.store(false, std::memory_order_relaxed);
+            }
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+Jobs::Jobs(unsigned int num_threads, bool pin_threads)
     : m_num_threads(std::max(1u, num_threads)),
-      m_ring_buffer(),
-      m_ring_buffer_mutex(),
-      m_wake_condition(),
-      m_wake_condition_mutex(),
+      m_worker_queues(),
+      m_injection_queue(),
+      m_background_queue(),
+      m_queued_jobs(0),
+      m_queued_background_jobs(0),
+      m_num_threads_sleeping(0),
+      m_wake_epoch(0),
       m_current_label(0),
       m_finished_label(0),
       m_shutdown_threads(false),
-      m_num_threads_running(0),
+      m_main_thread_jobs(),
+      m_main_thread_jobs_running(),
+      m_main_thread_jobs_mutex(),
+      m_counters(std::make_unique<WorkerCounters[]>(m_num_threads + 1)),
+      m_queued_jobs_high_water(0),
+      m_injection_overflows(0),
+      m_stats_start_ns(nowNs()),
+      m_worker_cpus(),
       m_workers()
 {
+    if (pin_threads) {
+        const std::vector<unsigned int> order = getCPUPlacementOrder(getCPUTopology());
+        for (unsigned int thread_id = 0; thread_id < m_num_threads; ++thread_id) {
+            // skip the first CPU, it's left for the main thread
+            m_worker_cpus.push_back(order[(thread_id + (order.size() > 1 ? 1 : 0)) % order.size()]);
+        }
+    }
+
+    // every queue must exist before any worker starts stealing
     for (unsigned int thread_id = 0; thread_id < m_num_threads; ++thread_id) {
-        m_workers.emplace_back([&ring_buffer = m_ring_buffer, &ring_buffer_mutex = m_ring_buffer_mutex, &finished_label = m_finished_label,
-                                &wake_condition = m_wake_condition, &wake_condition_mutex = m_wake_condition_mutex, &shutdown_threads = m_shutdown_threads,
-                                &num_threads_running = m_num_threads_running, thread_id] {
-            tracy::SetThreadNameWithHint(std::format("worker{}", thread_id).c_str(), 1);
-            num_threads_running.fetch_add(1);
-            for (;;) {
-                ring_buffer_mutex.lock();
-                auto job = ring_buffer.popFront();
-                ring_buffer_mutex.unlock();
-                if (job.has_value()) {
-                    ZoneScopedN("worker running job");
-                    // execute new job
-                    GC_TRACE("Running job from ring buffer...");
-                    job.value().operator()();
-                    finished_label.fetch_add(1);
-                }
-                else {
-                    // no job right now. make thread sleep
-                    {
-                        // GC_TRACE("Thread going to sleep...");
-                        std::unique_lock<std::mutex> lock(wake_condition_mutex);
-                        wake_condition.wait(lock);
-                        // GC_TRACE("Thread woke up");
-                    }
-                    if (shutdown_threads.load()) {
-                        // GC_TRACE("Shutting down thread...");
-                        num_threads_running.fetch_sub(1);
-                        return; // end thread
-                    }
-                }
-            }
-        });
+        m_worker_queues.push_back(std::make_unique<WorkStealingDeque<Job*>>());
     }
-    // now ensure threads have actually started
-    while (m_num_threads_running < m_num_threads) {
-        std::this_thread::yield();
+    for (unsigned int thread_id = 0; thread_id < m_num_threads; ++thread_id) {
+        m_workers.emplace_back([this, thread_id] { workerLoop(thread_id); });
     }
     GC_TRACE("Initialised job system");
 }
@@ -71,90 +331,437 @@ Jobs::~Jobs()
     GC_TRACE("Destroying job system...");
     wait();
     m_shutdown_threads.store(true);
-    while (m_num_threads_running.load() > 0) { // wait until all threads have stopped running
-        m_wake_condition.notify_one();
-        std::this_thread::yield();
-    }
+    m_wake_epoch.fetch_add(1);
+    m_wake_epoch.notify_all();
     for (std::thread& worker : m_workers) {
         worker.join();
     }
 }
 
-void Jobs::execute(const std::function<void()>& func)
+JobHandle Jobs::execute(JobFunction func, std::span<const JobHandle> dependencies, JobPriority priority)
+{
+    JobHandle::Counter* const counter = acquireCounter(1, priority);
+    Job* const job = acquireJob(std::move(func), counter);
+    submit(counter, job, job, dependencies);
+    return JobHandle(counter);
+}
+
+JobHandle Jobs::dispatch(unsigned int job_count, unsigned int group_size, JobDispatchFunction func, std::span<const JobHandle> dependencies,
+                         JobPriority priority)
+{
+    if (job_count == 0 || group_size == 0) {
+        return {};
+    }
+
+    const unsigned int group_count = static_cast<unsigned int>(std::ceil(static_cast<double>(job_count) / static_cast<double>(group_size)));
+    GC_ASSERT(group_count * group_size >= job_count);
+
+    JobHandle::Counter* const counter = acquireCounter(group_count, priority);
+    counter->dispatch_func = std::move(func);
+    counter->dispatch_job_count = job_count;
+    counter->dispatch_group_size = group_size;
+
+    Job* first = nullptr;
+    Job* last = nullptr;
+    for (unsigned int group_index = 0; group_index < group_count; ++group_index) {
+        Job* const job = acquireJob(
+            [counter, group_index]() {
+                const unsigned int group_job_offset = group_index * counter->dispatch_group_size;
+                const unsigned int group_job_end = std::min(group_job_offset + counter->dispatch_group_size, counter->dispatch_job_count);
+
+                JobDispatchArgs args{};
+                args.group_index = group_index;
+
+                for (unsigned int i = group_job_offset; i < group_job_end; ++i) {
+                    args.job_index = i;
+                    counter->dispatch_func(args);
+                }
+            },
+            counter);
+        if (last) {
+            last->next = job;
+        }
+        else {
+            first = job;
+        }
+        last = job;
+    }
+
+    submit(counter, first, last, dependencies);
+    return JobHandle(counter);
+}
+
+void Jobs::executeOnMainThread(JobFunction func)
 {
-    m_current_label += 1;
+    std::lock_guard<std::mutex> lock(m_main_thread_jobs_mutex);
+    m_main_thread_jobs.push_back(std::move(func));
+}
 
-    // infinite loop until func is pushed
+void Jobs::runMainThreadJobs()
+{
+    GC_ASSERT(isMainThread());
+
+    {
+        std::lock_guard<std::mutex> lock(m_main_thread_jobs_mutex);
+        if (m_main_thread_jobs.empty()) {
+            return;
+        }
+        m_main_thread_jobs_running.swap(m_main_thread_jobs);
+    }
+
+    ZoneScoped;
+    for (JobFunction& func : m_main_thread_jobs_running) {
+        func();
+    }
+    m_main_thread_jobs_running.clear();
+}
+
+bool Jobs::isBusy()
+{
+    // if finished label hasn't reached current label, jobs are still executing
+    uint64_t finished_label = m_finished_label.load();
+    return finished_label < m_current_label;
+}
+
+void Jobs::wait()
+{
+    GC_ASSERT(t_worker_jobs != this);
+
+    unsigned int spins = 0;
     for (;;) {
-        m_ring_buffer_mutex.lock();
-        bool was_pushed = m_ring_buffer.pushBack(func);
-        m_ring_buffer_mutex.unlock();
-        if (was_pushed) {
-            m_wake_condition.notify_one(); // now job has been pushed, wake a thread to execute it
+        const uint64_t finished_label = m_finished_label.load();
+        if (finished_label >= m_current_label.load()) {
             return;
         }
+        if (Job* const job = findJob(true)) {
+            runJob(job);
+            spins = 0;
+        }
+        else if (spins < SPIN_COUNT) {
+            ++spins;
+            cpuRelax();
+        }
         else {
-            m_wake_condition.notify_one(); // wake up a thread to hopefully free up the job ring buffer
-            std::this_thread::yield();     // allow rescheduling
+            // every queued job has been taken, park until the last one finishes
+            m_finished_label.wait(finished_label);
         }
     }
 }
 
-void Jobs::dispatch(unsigned int job_count, unsigned int group_size, const std::function<void(JobDispatchArgs)>& func)
+void Jobs::wait(const JobHandle& handle)
 {
-    if (job_count == 0 || group_size == 0) {
+    if (!handle.m_counter) {
         return;
     }
 
-    const unsigned int group_count = static_cast<unsigned int>(std::ceil(static_cast<double>(job_count) / static_cast<double>(group_size)));
-    GC_ASSERT(group_count * group_size >= job_count);
+    // waiting for frame-critical jobs must not get stuck behind a long background job
+    const bool include_background = (handle.m_counter->priority == JobPriority::BACKGROUND);
+    unsigned int spins = 0;
+    for (;;) {
+        const unsigned int remaining = handle.m_counter->remaining.load(std::memory_order_acquire);
+        if (remaining == 0) {
+            return;
+        }
+        if (Job* const job = findJob(include_background)) {
+            runJob(job);
+            spins = 0;
+        }
+        else if (spins < SPIN_COUNT) {
+            ++spins;
+            cpuRelax();
+        }
+        else {
+            // Jobs still running elsewhere, runJob() notifies when the counter reaches zero.
+            // This doesn't help with jobs queued while parked but the wait is short by then.
+            handle.m_counter->remaining.wait(remaining, std::memory_order_acquire);
+        }
+    }
+}
+
+JobStats Jobs::getStats() const
+{
+    JobStats stats{};
+    stats.elapsed = std::chrono::nanoseconds(nowNs() - m_stats_start_ns.load(std::memory_order_relaxed));
 
-    m_current_label += group_count;
+    const auto read_counters = [&stats](const WorkerCounters& counters) {
+        JobWorkerStats worker{};
+        worker.jobs_executed = counters.jobs_executed.load(std::memory_order_relaxed);
+        worker.busy_time = std::chrono::nanoseconds(counters.busy_ns.load(std::memory_order_relaxed));
+        worker.parked_time = std::chrono::nanoseconds(counters.parked_ns.load(std::memory_order_relaxed));
+        worker.steal_attempts = counters.steal_attempts.load(std::memory_order_relaxed);
+        worker.steals = counters.steals.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < JOB_LATENCY_BUCKET_COUNT; ++i) {
+            stats.latency_histogram[i] += counters.latency_histogram[i].load(std::memory_order_relaxed);
+        }
+        return worker;
+    };
 
-    for (unsigned int group_index = 0; group_index < group_count; ++group_index) {
-        auto job_group = [job_count, group_size, func, group_index]() {
-            const unsigned int group_job_offset = group_index * group_size;
-            const unsigned int group_job_end = std::min(group_job_offset + group_size, job_count);
+    stats.workers.reserve(m_num_threads);
+    for (unsigned int thread_id = 0; thread_id < m_num_threads; ++thread_id) {
+        stats.workers.push_back(read_counters(m_counters[thread_id]));
+    }
+    stats.other_threads = read_counters(m_counters[m_num_threads]);
+
+    stats.queued_jobs = std::max(int64_t{0}, m_queued_jobs.load(std::memory_order_relaxed));
+    stats.queued_background_jobs = std::max(int64_t{0}, m_queued_background_jobs.load(std::memory_order_relaxed));
+    stats.queued_jobs_high_water = m_queued_jobs_high_water.load(std::memory_order_relaxed);
+    stats.injection_overflows = m_injection_overflows.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Jobs::resetStats()
+{
+    for (unsigned int i = 0; i < m_num_threads + 1; ++i) {
+        WorkerCounters& counters = m_counters[i];
+        counters.jobs_executed.store(0, std::memory_order_relaxed);
+        counters.busy_ns.store(0, std::memory_order_relaxed);
+        counters.parked_ns.store(0, std::memory_order_relaxed);
+        counters.steal_attempts.store(0, std::memory_order_relaxed);
+        counters.steals.store(0, std::memory_order_relaxed);
+        for (std::atomic<uint64_t>& bucket : counters.latency_histogram) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+    m_queued_jobs_high_water.store(std::max(int64_t{0}, m_queued_jobs.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    m_injection_overflows.store(0, std::memory_order_relaxed);
+    m_stats_start_ns.store(nowNs(), std::memory_order_relaxed);
+}
+
+JobHandle::Counter* Jobs::acquireCounter(unsigned int job_count, JobPriority priority)
+{
+    // slots come from the pool on this thread or through the pool's mutex, so relaxed stores are enough
+    JobHandle::Counter* const counter = SlotPool<JobHandle::Counter>::acquire();
+    counter->references.store(job_count + 1, std::memory_order_relaxed);
+    counter->remaining.store(job_count, std::memory_order_relaxed);
+    counter->held_first = nullptr;
+    counter->held_last = nullptr;
+    counter->held_count = 0;
+    counter->done = false;
+    counter->jobs = this;
+    counter->priority = priority;
+    return counter;
+}
 
-            JobDispatchArgs args{};
-            args.group_index = group_index;
+Jobs::Job* Jobs::acquireJob(JobFunction&& func, JobHandle::Counter* counter)
+{
+    Job* const job = SlotPool<Job>::acquire();
+    job->func = std::move(func);
+    job->counter = counter;
+    return job;
+}
+
+void Jobs::submit(JobHandle::Counter* counter, Job* first, Job* last, std::span<const JobHandle> dependencies)
+{
+    const unsigned int job_count = counter->remaining.load(std::memory_order_relaxed);
+
+    // the label must be raised before any job can finish, including jobs held back by dependencies
+    m_current_label.fetch_add(job_count);
+
+    if (dependencies.empty()) {
+        pushJobs(first, last, job_count);
+        return;
+    }
 
-            for (unsigned int i = group_job_offset; i < group_job_end; ++i) {
-                args.job_index = i;
-                func(args);
+    counter->held_first = first;
+    counter->held_last = last;
+    counter->held_count = job_count;
+
+    // The extra count stops the jobs being released by a dependency finishing while the others are still being registered
+    counter->dependencies_remaining.store(dependencies.size() + 1, std::memory_order_relaxed);
+    for (const JobHandle& dependency : dependencies) {
+        bool registered = false;
+        if (dependency.m_counter) {
+            std::lock_guard<std::mutex> lock(dependency.m_counter->dependents_mutex);
+            if (!dependency.m_counter->done) {
+                dependency.m_counter->dependents.push_back(counter);
+                registered = true;
             }
-        };
-
-        // infinite loop until job_group is pushed
-        for (;;) {
-            m_ring_buffer_mutex.lock();
-            bool was_pushed = m_ring_buffer.pushBack(job_group);
-            m_ring_buffer_mutex.unlock();
-            if (was_pushed) {
-                break;
+        }
+        if (!registered) {
+            releaseDependency(counter);
+        }
+    }
+    releaseDependency(counter);
+}
+
+void Jobs::runJob(Job* job)
+{
+    WorkerCounters& counters = localCounters();
+    const int64_t start_ns = nowNs();
+    counters.latency_histogram[latencyBucket(start_ns - job->queued_ns)].fetch_add(1, std::memory_order_relaxed);
+
+    job->func();
+    job->func.reset();
+
+    JobHandle::Counter* const counter = job->counter;
+    SlotPool<Job>::release(job);
+
+    if (counter->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        counter->remaining.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(counter->dependents_mutex);
+            counter->done = true;
+        }
+        // nothing else touches the list once done is set. clear() keeps its capacity for the next use of the counter
+        for (JobHandle::Counter* dependent : counter->dependents) {
+            releaseDependency(dependent);
+        }
+        counter->dependents.clear();
+    }
+    JobHandle::releaseReference(counter);
+
+    if (m_finished_label.fetch_add(1) + 1 == m_current_label.load()) {
+        m_finished_label.notify_all();
+    }
+
+    counters.jobs_executed.fetch_add(1, std::memory_order_relaxed);
+    counters.busy_ns.fetch_add(nowNs() - start_ns, std::memory_order_relaxed);
+}
+
+void Jobs::releaseDependency(JobHandle::Counter* counter)
+{
+    if (counter->dependencies_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // the counter may be recycled as soon as its jobs run so don't touch it after pushing them
+        pushJobs(counter->held_first, counter->held_last, counter->held_count);
+    }
+}
+
+void Jobs::workerLoop(unsigned int thread_id)
+{
+    tracy::SetThreadNameWithHint(std::format("worker{}", thread_id).c_str(), 1);
+    t_worker_jobs = this;
+    t_worker_index = thread_id;
+
+    if (!m_worker_cpus.empty() && !pinCurrentThreadToCPU(m_worker_cpus[thread_id])) {
+        GC_WARN("Failed to pin job worker {} to CPU {}", thread_id, m_worker_cpus[thread_id]);
+    }
+
+    // Jobs running on this thread may be using its frame arena, so it is only reset here between top-level jobs
+    FrameArena& frame_arena = FrameArena::local();
+
+    unsigned int spins = 0;
+    for (;;) {
+        if (Job* const job = findJob(true)) {
+            ZoneScopedN("worker running job");
+            frame_arena.resetIfNewFrame();
+            runJob(job);
+            spins = 0;
+        }
+        else if (spins < SPIN_COUNT) {
+            ++spins;
+            cpuRelax();
+        }
+        else {
+            // No job for a while, park until one is pushed.
+            // The sleeping count is raised before checking for jobs, see pushJobs().
+            spins = 0;
+            m_num_threads_sleeping.fetch_add(1);
+            const uint32_t wake_epoch = m_wake_epoch.load();
+            if (m_queued_jobs.load() <= 0 && m_queued_background_jobs.load() <= 0 && !m_shutdown_threads.load()) {
+                const int64_t park_start_ns = nowNs();
+                m_wake_epoch.wait(wake_epoch);
+                m_counters[thread_id].parked_ns.fetch_add(nowNs() - park_start_ns, std::memory_order_relaxed);
             }
-            else {
-                m_wake_condition.notify_one(); // wake up a thread to hopefully free up the job ring buffer
-                std::this_thread::yield();     // allow rescheduling
+            m_num_threads_sleeping.fetch_sub(1);
+            if (m_shutdown_threads.load() && m_queued_jobs.load() <= 0 && m_queued_background_jobs.load() <= 0) {
+                return; // end thread
             }
         }
-
-        m_wake_condition.notify_one();
     }
 }
 
-bool Jobs::isBusy()
+Jobs::Job* Jobs::findJob(bool include_background)
 {
-    // if finished label hasn't reached current label, jobs are still executing
-    uint64_t finished_label = m_finished_label.load();
-    return finished_label < m_current_label;
+    // cheap checks so spinning threads don't hammer the queues
+    if (m_queued_jobs.load(std::memory_order_relaxed) > 0) {
+        const bool is_worker = (t_worker_jobs == this);
+        Job* job = nullptr;
+        if (is_worker) {
+            job = m_worker_queues[t_worker_index]->pop().value_or(nullptr);
+        }
+
+        if (!job) {
+            job = m_injection_queue.pop();
+        }
+
+        // steal from the workers, starting with the next one along so thieves spread out
+        const unsigned int first_victim = is_worker ? t_worker_index + 1 : 0;
+        for (unsigned int i = 0; !job && i < m_num_threads; ++i) {
+            const unsigned int victim = (first_victim + i) % m_num_threads;
+            WorkStealingDeque<Job*>& queue = *m_worker_queues[victim];
+            if ((!is_worker || victim != t_worker_index) && !queue.empty()) {
+                WorkerCounters& counters = localCounters();
+                counters.steal_attempts.fetch_add(1, std::memory_order_relaxed);
+                job = queue.steal().value_or(nullptr);
+                if (job) {
+                    counters.steals.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        if (job) {
+            m_queued_jobs.fetch_sub(1);
+            return job;
+        }
+    }
+
+    if (include_background && m_queued_background_jobs.load(std::memory_order_relaxed) > 0) {
+        if (Job* const job = m_background_queue.pop()) {
+            m_queued_background_jobs.fetch_sub(1);
+            return job;
+        }
+    }
+
+    return nullptr;
 }
 
-void Jobs::wait()
+Jobs::WorkerCounters& Jobs::localCounters() { return m_counters[t_worker_jobs == this ? t_worker_index : m_num_threads]; }
+
+void Jobs::pushJobs(Job* first, Job* last, unsigned int count)
 {
-    while (isBusy()) {
-        m_wake_condition.notify_one();
-        std::this_thread::yield();
+    // every job in the list belongs to the same counter, read it before the jobs can run and recycle it
+    const bool background = (first->counter->priority == JobPriority::BACKGROUND);
+
+    last->next = nullptr;
+    const int64_t queued_ns = nowNs();
+    if (t_worker_jobs == this && !background) {
+        WorkStealingDeque<Job*>& queue = *m_worker_queues[t_worker_index];
+        for (Job* job = first; job;) {
+            Job* const next = job->next; // the job may be stolen and recycled as soon as it is pushed
+            job->queued_ns = queued_ns;
+            queue.push(job);
+            job = next;
+        }
+    }
+    else {
+        for (Job* job = first; job; job = job->next) {
+            job->queued_ns = queued_ns;
+        }
+        // background jobs always go through their own queue so workers only pick them up when out of frame-critical work
+        if (!(background ? m_background_queue : m_injection_queue).push(first, last)) {
+            m_injection_overflows.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // A worker raises m_num_threads_sleeping before checking the queued counts, so either it sees these jobs or we see it sleeping.
+    // Bumping the epoch stops a worker that read the old epoch before these jobs were counted from parking.
+    if (background) {
+        m_queued_background_jobs.fetch_add(static_cast<int64_t>(count));
+    }
+    else {
+        const int64_t queued_jobs = m_queued_jobs.fetch_add(static_cast<int64_t>(count)) + static_cast<int64_t>(count);
+        int64_t high_water = m_queued_jobs_high_water.load(std::memory_order_relaxed);
+        while (queued_jobs > high_water && !m_queued_jobs_high_water.compare_exchange_weak(high_water, queued_jobs, std::memory_order_relaxed)) {
+        }
+    }
+    if (m_num_threads_sleeping.load() > 0) {
+        m_wake_epoch.fetch_add(1);
+        if (count == 1) {
+            m_wake_epoch.notify_one();
+        }
+        else {
+            m_wake_epoch.notify_all();
+        }
     }
 }
 
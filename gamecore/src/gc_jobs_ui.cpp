@@ -0,0 +1,104 @@
+#include "gamecore/gc_jobs_ui.h"
+
+#include <cfloat>
+#include <cinttypes>
+#include <cstdio>
+
+#include <array>
+#include <chrono>
+
+#include <imgui.h>
+
+#include "gamecore/gc_jobs.h"
+
+namespace gc {
+
+static double percentOf(std::chrono::nanoseconds part, std::chrono::nanoseconds whole)
+{
+    return whole.count() > 0 ? 100.0 * static_cast<double>(part.count()) / static_cast<double>(whole.count()) : 0.0;
+}
+
+static void workerRow(const char* name, const JobWorkerStats& worker, std::chrono::nanoseconds elapsed)
+{
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(name);
+    ImGui::TableNextColumn();
+    ImGui::Text("%" PRIu64, worker.jobs_executed);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f%%", percentOf(worker.busy_time, elapsed));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f%%", percentOf(worker.parked_time, elapsed));
+    ImGui::TableNextColumn();
+    ImGui::Text("%" PRIu64 " / %" PRIu64, worker.steals, worker.steal_attempts);
+}
+
+void renderJobsUI(Jobs& jobs)
+{
+    if (ImGui::Begin("Jobs")) {
+        const JobStats stats = jobs.getStats();
+        const double elapsed_sec = std::chrono::duration<double>(stats.elapsed).count();
+
+        ImGui::Text("Workers: %u", jobs.getNumThreads());
+        ImGui::Text("Measuring for %.1f s", elapsed_sec);
+        ImGui::SameLine();
+        if (ImGui::Button("Reset")) {
+            jobs.resetStats();
+        }
+
+        uint64_t total_jobs = stats.other_threads.jobs_executed;
+        std::chrono::nanoseconds total_busy = stats.other_threads.busy_time;
+        for (const JobWorkerStats& worker : stats.workers) {
+            total_jobs += worker.jobs_executed;
+            total_busy += worker.busy_time;
+        }
+        ImGui::Text("Jobs run: %" PRIu64 " (%.0f per second)", total_jobs, elapsed_sec > 0.0 ? static_cast<double>(total_jobs) / elapsed_sec : 0.0);
+        // 100% means one thread's worth of work, so perfect scaling reads as the number of workers times 100%
+        ImGui::Text("Total busy: %.1f%%", percentOf(total_busy, stats.elapsed));
+        ImGui::Text("Queued: %" PRId64 " (high water %" PRId64 ")", stats.queued_jobs, stats.queued_jobs_high_water);
+        ImGui::Text("Queued background: %" PRId64, stats.queued_background_jobs);
+        ImGui::Text("Injection queue overflows: %" PRIu64, stats.injection_overflows);
+
+        if (ImGui::BeginTable("workers", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Thread");
+            ImGui::TableSetupColumn("Jobs");
+            ImGui::TableSetupColumn("Busy");
+            ImGui::TableSetupColumn("Parked");
+            ImGui::TableSetupColumn("Steals / tries");
+            ImGui::TableHeadersRow();
+
+            std::array<char, 16> name{};
+            for (std::size_t i = 0; i < stats.workers.size(); ++i) {
+                std::snprintf(name.data(), name.size(), "worker%zu", i);
+                workerRow(name.data(), stats.workers[i], stats.elapsed);
+            }
+            workerRow("other", stats.other_threads, stats.elapsed);
+            ImGui::EndTable();
+        }
+
+        // time between a job being queued and starting
+        std::array<float, JOB_LATENCY_BUCKET_COUNT> latency_histogram{};
+        for (std::size_t i = 0; i < JOB_LATENCY_BUCKET_COUNT; ++i) {
+            latency_histogram[i] = static_cast<float>(stats.latency_histogram[i]);
+        }
+        ImGui::PlotHistogram("Start latency", latency_histogram.data(), static_cast<int>(latency_histogram.size()), 0, "<1us ... >16ms (log2 buckets)",
+                             0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
+        if (ImGui::TreeNode("Start latency buckets")) {
+            for (std::size_t i = 0; i < JOB_LATENCY_BUCKET_COUNT; ++i) {
+                if (i == 0) {
+                    ImGui::Text("      <1 us: %" PRIu64, stats.latency_histogram[i]);
+                }
+                else if (i == JOB_LATENCY_BUCKET_COUNT - 1) {
+                    ImGui::Text(">= %6u us: %" PRIu64, 1u << (i - 1), stats.latency_histogram[i]);
+                }
+                else {
+                    ImGui::Text("<  %6u us: %" PRIu64, 1u << i, stats.latency_histogram[i]);
+                }
+            }
+            ImGui::TreePop();
+        }
+    }
+    ImGui::End();
+}
+
+} // namespace gc
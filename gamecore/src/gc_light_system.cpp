@@ -15,10 +15,11 @@ void LightSystem::onUpdate(FrameState& frame_state)
 {
     ZoneScoped;
 
-    m_world.forEach<TransformComponent, LightComponent>([&]([[maybe_unused]] Entity entity, const TransformComponent& t, [[maybe_unused]] const LightComponent& l) {
-        frame_state.draw_data.setLightPos(t.getWorldPosition());
-        // TODO: support more than one light!
-    });
+    m_world.forEach<const TransformComponent, const LightComponent>(
+        [&]([[maybe_unused]] Entity entity, const TransformComponent& t, [[maybe_unused]] const LightComponent& l) {
+            frame_state.draw_data.setLightPos(t.getWorldPosition());
+            // TODO: support more than one light!
+        });
 }
 
 } // namespace gc
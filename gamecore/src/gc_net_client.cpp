@@ -400,13 +400,15 @@ asio::awaitable<void> NetClient::keepAliveLoop()
     constexpr int64_t TIMEOUT_TIME_NS = 5'000'000'000LL;         // 5 s
     constexpr int64_t KEEPALIVE_IDLE_TIME_NS = 500'000'000LL;    // 500 ms
 
+    std::vector<uint16_t> to_retransmit{}; // reused every iteration so it only allocates when it grows
+
     for (;;) {
         // maybe timer can be reset every iteration instead of reconstructing?
         asio::steady_timer timer(executor, TIME_PERIOD);
 
         const int64_t now = SDL_GetTicksNS();
 
-        std::vector<uint16_t> to_retransmit{};
+        to_retransmit.clear();
         for (auto it = m_session.retransmit_queue.begin(); it != m_session.retransmit_queue.end();) {
             auto& [seq_num, packet] = *it;
             if (packet.attempts >= packet.MAX_ATTEMPTS || seq_diff(seq_num, m_session.next_seq_num) < -static_cast<int16_t>(m_session.ack_bits.size() * 2)) {
@@ -516,17 +516,19 @@ asio::awaitable<void> NetServer::keepAliveLoop()
     constexpr int64_t TIMEOUT_TIME_NS = 5'000'000'000LL;         // 5 s
     constexpr int64_t KEEPALIVE_IDLE_TIME_NS = 500'000'000LL;    // 500 ms
 
+    struct RetransmitWork {
+        NetSessionToken token{};
+        uint16_t seq_num{};
+    };
+    std::vector<RetransmitWork> retransmit_work{}; // reused every iteration so it only allocates when it grows
+
     for (;;) {
         // maybe timer can be reset every iteration instead of reconstructing?
         asio::steady_timer timer(executor, TIME_PERIOD);
 
         const int64_t now = SDL_GetTicksNS();
 
-        struct RetransmitWork {
-            NetSessionToken token{};
-            uint16_t seq_num{};
-        };
-        std::vector<RetransmitWork> retransmit_work{};
+        retransmit_work.clear();
         for (auto& [_, session] : m_sessions) {
             for (auto it = session.retransmit_queue.begin(); it != session.retransmit_queue.end();) {
                 auto& [seq_num, packet] = *it;
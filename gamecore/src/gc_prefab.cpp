@@ -1,11 +1,15 @@
 #include "gamecore/gc_prefab.h"
 
+#include <algorithm>
+#include <optional>
 #include <vector>
 
 #include <gctemplates/gct_sv_stream.h>
 
 #include <gcpak/gcpak_prefab.h>
 
+#include <tracy/Tracy.hpp>
+
 #include "gclog/gclog.h"
 #include "gamecore/gc_transform_component.h"
 #include "gamecore/gc_renderable_component.h"
@@ -13,30 +17,19 @@
 
 namespace gc {
 
-static Entity deserialiseTransform(gct::sv_istream& data_stream, World& world, std::span<const Entity> entities, Entity prefab_parent)
-{
-    uint32_t parent_index{};
-    auto deserialised_transform = TransformComponent::deserialize(data_stream, parent_index);
-    if (!data_stream) {
-        return ENTITY_NONE;
-    }
-
-    // figure out parent entity
-    Entity parent{prefab_parent};
-    if (parent_index != ENTITY_NONE && parent_index < static_cast<uint32_t>(entities.size())) {
-        parent = entities[parent_index];
-    }
-
-    return world.createEntity(deserialised_transform.name, parent, deserialised_transform.getPosition(), deserialised_transform.getRotation(),
-                              deserialised_transform.getScale());
-}
+// Decoded once and then copied into the World for every instance of the prefab
+struct PrefabEntity {
+    TransformComponent transform;
+    uint32_t parent_index; // index of the parent PrefabEntity, the prefab parent is used if it isn't an earlier entity
+    std::optional<RenderableComponent> renderable;
+};
 
-Entity loadPrefab(std::span<const uint8_t> data, World& world, Entity prefab_parent)
+static std::vector<PrefabEntity> parsePrefab(std::span<const uint8_t> data)
 {
     const std::string_view data_sv(reinterpret_cast<const char*>(data.data()), data.size());
     gct::sv_istream data_stream(data_sv);
 
-    std::vector<Entity> entities{};
+    std::vector<PrefabEntity> entities{};
 
     while (!data_stream.eof()) {
 
@@ -50,28 +43,23 @@ Entity loadPrefab(std::span<const uint8_t> data, World& world, Entity prefab_par
             abortGame("Corrupt prefab asset");
         }
 
-        Entity current_entity{ENTITY_NONE};
-        if (!entities.empty()) {
-            current_entity = entities.back();
-        }
-
         switch (type) {
         case gcpak::PrefabComponentType::TRANSFORM: {
-            Entity e = deserialiseTransform(data_stream, world, entities, prefab_parent);
-            if (e == ENTITY_NONE) {
+            PrefabEntity& entity = entities.emplace_back();
+            entity.transform = TransformComponent::deserialize(data_stream, entity.parent_index);
+            if (!data_stream) {
                 abortGame("Error reading transform from prefab");
             }
-            entities.push_back(e);
         } break;
         case gcpak::PrefabComponentType::RENDERABLE: {
             const auto r = RenderableComponent::deserialize(data_stream);
             if (!data_stream) {
                 abortGame("Error deserialising RenderableComponent from prefab");
             }
-            if (world.getComponent<RenderableComponent>(current_entity)) {
+            if (entities.back().renderable) {
                 abortGame("Duplicate component in prefab entity");
             }
-            world.addComponent<RenderableComponent>(current_entity) = r;
+            entities.back().renderable = r;
         } break;
         case gcpak::PrefabComponentType::CAMERA:
             [[fallthrough]];
@@ -82,7 +70,53 @@ Entity loadPrefab(std::span<const uint8_t> data, World& world, Entity prefab_par
         }
     }
 
-    return entities[0];
+    return entities;
+}
+
+Entity loadPrefab(std::span<const uint8_t> data, World& world, Entity prefab_parent) { return instantiatePrefab(data, world, 1, prefab_parent)[0]; }
+
+std::vector<Entity> instantiatePrefab(std::span<const uint8_t> data, World& world, uint32_t count, Entity prefab_parent)
+{
+    ZoneScoped;
+
+    const std::vector<PrefabEntity> prefab = parsePrefab(data);
+
+    world.reserveEntities(static_cast<uint32_t>(prefab.size()) * count);
+
+    // instances[i][k] is prefab entity i in instance k.
+    // Every instance of a prefab entity is created together, each under the same prefab entity of its own instance.
+    std::vector<std::vector<Entity>> instances(prefab.size());
+    uint32_t renderable_count = 0;
+    Entity highest_entity = 0;
+    for (std::size_t i = 0; i < prefab.size(); ++i) {
+        const PrefabEntity& prefab_entity = prefab[i];
+        const TransformComponent& t = prefab_entity.transform;
+        if (prefab_entity.parent_index < i) {
+            instances[i] = world.createEntities(instances[prefab_entity.parent_index], t.getName(), t.getPosition(), t.getRotation(), t.getScale());
+        }
+        else {
+            instances[i] = world.createEntities(count, t.getName(), prefab_parent, t.getPosition(), t.getRotation(), t.getScale());
+        }
+
+        if (prefab_entity.renderable && count != 0) {
+            renderable_count += count;
+            highest_entity = std::max(highest_entity, std::ranges::max(instances[i]));
+        }
+    }
+
+    // Components are added once every entity exists so their storage only has to grow once
+    if (renderable_count != 0) {
+        world.reserveComponents<RenderableComponent>(renderable_count, highest_entity);
+        for (std::size_t i = 0; i < prefab.size(); ++i) {
+            if (prefab[i].renderable) {
+                for (Entity entity : instances[i]) {
+                    world.addComponent<RenderableComponent>(entity) = *prefab[i].renderable;
+                }
+            }
+        }
+    }
+
+    return instances[0];
 }
 
 } // namespace gc
\ No newline at end of file
@@ -358,6 +358,7 @@ RenderBackend::~RenderBackend()
     // The destructors for these objects defer destruction until the resource is no longer in use by a GPU queue.
     m_frame_uniform_buffer_set.reset();
     m_instancing_transforms_buffer.reset();
+    m_static_instancing_transforms_buffer.reset();
     m_frame_uniform_buffer.reset();
     m_main_pipeline.reset();
     m_instancing_pipeline.reset();
@@ -562,6 +563,34 @@ void RenderBackend::submitFrame(bool window_resized, const WorldDrawData& world_
         vkCmdPipelineBarrier2(stuff.cmd, &dep);
     }
 
+    if (const StaticDrawBatches* static_batches = world_draw_data.getStaticDrawBatches();
+        static_batches && !static_batches->transforms.empty() && static_batches->generation != m_static_instancing_transforms_generation) {
+        TracyVkZone(m_tracy_vulkan_context.ctx, stuff.cmd, "Copy static instance transforms");
+
+        const auto& transforms = static_batches->transforms;
+        const size_t buffer_data_size = transforms.size() * sizeof(transforms[0]);
+        const std::span<const uint8_t> transform_data(reinterpret_cast<const uint8_t*>(transforms.data()), buffer_data_size);
+        m_static_instancing_transforms_buffer->writeData(stuff.cmd, m_frame_count, m_main_timeline_semaphore, m_main_timeline_value + 1, transform_data);
+        m_static_instancing_transforms_generation = static_batches->generation;
+
+        VkBufferMemoryBarrier2 b{};
+        b.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        b.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        b.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        b.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
+        b.dstAccessMask = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+        b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.buffer = m_static_instancing_transforms_buffer->getBuffer();
+        b.size = VkDeviceSize(buffer_data_size);
+        b.offset = 0;
+        VkDependencyInfo dep{};
+        dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dep.bufferMemoryBarrierCount = 1;
+        dep.pBufferMemoryBarriers = &b;
+        vkCmdPipelineBarrier2(stuff.cmd, &dep);
+    }
+
     {
         ZoneScopedN("Record render commands");
         ZoneValue(m_frame_count);
@@ -621,7 +650,7 @@ void RenderBackend::submitFrame(bool window_resized, const WorldDrawData& world_
 
         recordWorldRenderingCommands(stuff.cmd, m_main_pipeline_layout, *m_main_pipeline, m_instancing_pipeline_layout, *m_instancing_pipeline,
                                      m_main_timeline_semaphore, m_main_timeline_value + 1, world_draw_data, *m_frame_uniform_buffer_set,
-                                     *m_instancing_transforms_buffer);
+                                     *m_instancing_transforms_buffer, *m_static_instancing_transforms_buffer);
 
         if (post_render_callback) {
             bool ret = post_render_callback(stuff.cmd);
@@ -1557,6 +1586,9 @@ void RenderBackend::recreateFramesInFlightResources()
     constexpr VkDeviceSize INSTANCING_BUFFER_INITIAL_SIZE = sizeof(glm::mat4) * 100; // 100 instances
     m_instancing_transforms_buffer = std::make_unique<RenderBuffer>(m_delete_queue, m_allocator.getHandle(), static_cast<uint32_t>(m_fif.size()),
                                                                     INSTANCING_BUFFER_INITIAL_SIZE, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    m_static_instancing_transforms_buffer = std::make_unique<RenderBuffer>(m_delete_queue, m_allocator.getHandle(), static_cast<uint32_t>(m_fif.size()),
+                                                                           INSTANCING_BUFFER_INITIAL_SIZE, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    m_static_instancing_transforms_generation = 0; // generations start at 1, so the new buffer is always filled before use
     {
         VkDescriptorSet ds{};
         VkDescriptorSetAllocateInfo info{};
@@ -1,5 +1,7 @@
 #include "gamecore/gc_render_system.h"
 
+#include <atomic>
+
 #include <tracy/Tracy.hpp>
 
 #include "gamecore/gc_renderable_component.h"
@@ -11,8 +13,11 @@
 
 namespace gc {
 
+// Shared by every RenderSystem so the backend never mistakes one world's static batches for another's
+static std::atomic<uint64_t> s_static_batches_generation{};
+
 RenderSystem::RenderSystem(gc::World& world, ResourceManager& resource_manager, RenderBackend& render_backend)
-    : gc::System(world), m_render_object_manager(resource_manager, render_backend)
+    : gc::System(world), m_render_object_manager(resource_manager, render_backend), m_renderables(world.query<const TransformComponent, const RenderableComponent>())
 {
 }
 
@@ -23,20 +28,72 @@ void RenderSystem::onUpdate(FrameState& frame_state)
     constexpr uint64_t INACTIVE_OBJECT_LIFETIME_FRAMES = 10;
     constexpr int AUTOMATIC_INSTANCING_THRESHOLD = 8;
 
-    m_instance_groups.clear();
+    // Removing a static instance marks the static batches dirty, dynamic ones are just taken out of their group
+    auto remove_if_not_drawn = [&](Entity entity) {
+        if (entity < m_instance_locations.size() && m_instance_locations[entity].mesh &&
+            (!m_world.getComponent<const TransformComponent>(entity) || !m_world.getComponent<const RenderableComponent>(entity))) {
+            removeInstance(entity);
+        }
+    };
+    const bool removals_known = m_world.forEachRemoved<TransformComponent>(m_last_update_tick, remove_if_not_drawn) &&
+                                m_world.forEachRemoved<RenderableComponent>(m_last_update_tick, remove_if_not_drawn);
+
+    if (!removals_known) {
+        // Removals from before last frame are no longer known so rebuild everything
+        m_instance_groups.clear();
+        m_static_instance_groups.clear();
+        m_instance_locations.clear();
+        m_unresolved_entities.clear();
+        m_static_batches_dirty = true;
+        m_renderables.forEach([&](Entity entity, const TransformComponent& t, const RenderableComponent& c) { updateInstance(entity, t, c); });
+    }
+    else {
+        // An entity that was removed and has been reused shows up here as its components are new
+        m_world.forEachChanged<TransformComponent>(m_last_update_tick, [&](Entity entity, const TransformComponent& t) {
+            if (const RenderableComponent* c = m_world.getComponent<const RenderableComponent>(entity)) {
+                updateInstance(entity, t, *c);
+            }
+        });
+        m_world.forEachChanged<RenderableComponent>(m_last_update_tick, [&](Entity entity, const RenderableComponent& c) {
+            if (const TransformComponent* t = m_world.getComponent<const TransformComponent>(entity)) {
+                updateInstance(entity, *t, c);
+            }
+        });
+    }
+    m_last_update_tick = m_world.getChangeTick();
 
-    m_world.forEach<TransformComponent, RenderableComponent>([&]([[maybe_unused]] Entity entity, const TransformComponent& t, const RenderableComponent& c) {
-        if (c.m_visible && !c.m_mesh.empty()) [[likely]] {
-            // resolve resources
-            RenderMesh* const mesh = m_render_object_manager.getRenderMesh(c.m_mesh);
-            RenderMaterial* const material = m_render_object_manager.getRenderMaterial(c.m_material);
-            if (mesh && material) [[likely]] {
-                m_instance_groups[{mesh, material}].push_back(t.getWorldMatrix());
+    // Entities that were resolved, changed or removed since they were added to the list are skipped
+    m_retry_entities.swap(m_unresolved_entities);
+    for (Entity entity : m_retry_entities) {
+        if (entity < m_instance_locations.size() && m_instance_locations[entity].unresolved) {
+            m_instance_locations[entity].unresolved = false; // updateInstance() adds it back if it still can't be resolved
+            const TransformComponent* t = m_world.getComponent<const TransformComponent>(entity);
+            const RenderableComponent* c = m_world.getComponent<const RenderableComponent>(entity);
+            if (t && c) {
+                updateInstance(entity, *t, *c);
             }
         }
-    });
+    }
+    m_retry_entities.clear();
+
+    if (m_static_batches_dirty) {
+        bakeStaticBatches();
+    }
+    else if (m_static_transforms_changed) {
+        m_static_draw_batches.generation = s_static_batches_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    m_static_transforms_changed = false;
+
+    if (!m_static_draw_batches.entries.empty()) {
+        for (const WorldInstancedDrawEntry& entry : m_static_draw_batches.entries) {
+            entry.mesh->setLastUsedFrame(frame_state.frame_count);
+            entry.material->setLastUsedFrame(frame_state.frame_count);
+        }
+        frame_state.draw_data.setStaticDrawBatches(&m_static_draw_batches);
+    }
 
-    for (const auto& [mesh_material, transforms] : m_instance_groups) {
+    for (const auto& [mesh_material, group] : m_instance_groups) {
+        const std::vector<glm::mat4>& transforms = group.transforms;
 
         RenderMesh* const mesh = mesh_material.first;
         RenderMaterial* const material = mesh_material.second;
@@ -60,4 +117,105 @@ void RenderSystem::onUpdate(FrameState& frame_state)
     }
 }
 
+void RenderSystem::updateInstance(Entity entity, const TransformComponent& t, const RenderableComponent& c)
+{
+    RenderMesh* mesh = nullptr;
+    RenderMaterial* material = nullptr;
+    if (c.m_visible && !c.m_mesh.empty()) [[likely]] {
+        // resolve resources
+        mesh = m_render_object_manager.getRenderMesh(c.m_mesh);
+        material = m_render_object_manager.getRenderMaterial(c.m_material);
+        if (!mesh || !material) [[unlikely]] {
+            mesh = nullptr;
+            material = nullptr;
+        }
+    }
+    const bool unresolved = c.m_visible && !c.m_mesh.empty() && !mesh;
+
+    if (entity >= m_instance_locations.size()) {
+        m_instance_locations.resize(entity + 1, InstanceLocation{nullptr, nullptr, 0, false, false});
+    }
+
+    const bool is_static = t.isStatic();
+    InstanceGroupMap& groups = is_static ? m_static_instance_groups : m_instance_groups;
+    const InstanceLocation location = m_instance_locations[entity];
+
+    if (location.mesh == mesh && location.material == material && location.is_static == is_static) {
+        if (mesh) {
+            // Only the transform has changed
+            InstanceGroup& group = groups.find({mesh, material})->second;
+            group.transforms[location.index] = t.getWorldMatrix();
+            if (is_static && !m_static_batches_dirty) {
+                // The baked layout still matches the groups, so only this instance's matrix is rewritten instead of rebaking every group
+                m_static_draw_batches.transforms[group.static_transform_offset + location.index] = group.transforms[location.index];
+                m_static_transforms_changed = true;
+            }
+        }
+    }
+    else {
+        if (location.mesh) {
+            removeInstance(entity);
+        }
+
+        if (mesh) {
+            InstanceGroup& group = groups[{mesh, material}];
+            m_instance_locations[entity] = InstanceLocation{mesh, material, static_cast<uint32_t>(group.transforms.size()), is_static, false};
+            group.transforms.push_back(t.getWorldMatrix());
+            group.entities.push_back(entity);
+            m_static_batches_dirty |= is_static;
+        }
+    }
+
+    InstanceLocation& new_location = m_instance_locations[entity];
+    if (unresolved && !new_location.unresolved) {
+        m_unresolved_entities.push_back(entity);
+    }
+    new_location.unresolved = unresolved;
+}
+
+void RenderSystem::removeInstance(Entity entity)
+{
+    InstanceLocation& location = m_instance_locations[entity];
+    InstanceGroupMap& groups = location.is_static ? m_static_instance_groups : m_instance_groups;
+    auto it = groups.find({location.mesh, location.material});
+    GC_ASSERT(it != groups.end());
+    InstanceGroup& group = it->second;
+
+    // swap-remove
+    const auto last_index = static_cast<uint32_t>(group.entities.size() - 1);
+    if (location.index != last_index) {
+        const Entity moved_entity = group.entities[last_index];
+        group.transforms[location.index] = group.transforms[last_index];
+        group.entities[location.index] = moved_entity;
+        m_instance_locations[moved_entity].index = location.index;
+    }
+    group.transforms.pop_back();
+    group.entities.pop_back();
+
+    if (group.entities.empty()) {
+        groups.erase(it);
+    }
+
+    m_static_batches_dirty |= location.is_static;
+    location = InstanceLocation{nullptr, nullptr, 0, false, false};
+}
+
+void RenderSystem::bakeStaticBatches()
+{
+    ZoneScoped;
+
+    m_static_draw_batches.entries.clear();
+    m_static_draw_batches.transforms.clear();
+    for (auto& [mesh_material, group] : m_static_instance_groups) {
+        const auto transform_offset = static_cast<uint32_t>(m_static_draw_batches.transforms.size());
+        const auto instance_count = static_cast<uint32_t>(group.transforms.size());
+        group.static_transform_offset = transform_offset;
+        m_static_draw_batches.entries.emplace_back(transform_offset, instance_count, mesh_material.first, mesh_material.second);
+        m_static_draw_batches.transforms.insert(m_static_draw_batches.transforms.end(), group.transforms.begin(), group.transforms.end());
+    }
+    m_static_draw_batches.generation = s_static_batches_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    m_static_batches_dirty = false;
+}
+
 } // namespace gc
@@ -1,6 +1,8 @@
 #include "gamecore/gc_render_world.h"
 #include <vulkan/vulkan_core.h>
 
+#include <span>
+
 #include <glm/mat4x4.hpp>
 
 #include "gamecore/gc_vulkan_common.h"
@@ -15,7 +17,7 @@ namespace gc {
 void recordWorldRenderingCommands(VkCommandBuffer cmd, VkPipelineLayout main_pipeline_layout, GPUPipeline& main_pipeline,
                                   VkPipelineLayout instancing_pipeline_layout, GPUPipeline& instancing_pipeline, VkSemaphore timeline_semaphore,
                                   uint64_t signal_value, const WorldDrawData& draw_data, GPUDescriptorSet& frame_uniform_buffer_set,
-                                  RenderBuffer& instance_transforms_buffer)
+                                  RenderBuffer& instance_transforms_buffer, RenderBuffer& static_instance_transforms_buffer)
 {
     GC_ASSERT(cmd);
     GC_ASSERT(main_pipeline_layout);
@@ -56,37 +58,52 @@ void recordWorldRenderingCommands(VkCommandBuffer cmd, VkPipelineLayout main_pip
         }
     }
 
-    if (!draw_data.getInstancedDrawEntries().empty()) {
+    const StaticDrawBatches* const static_batches = draw_data.getStaticDrawBatches();
+    const bool has_static_draws = static_batches && !static_batches->entries.empty();
+
+    if (!draw_data.getInstancedDrawEntries().empty() || has_static_draws) {
 
         instancing_pipeline.useResource(timeline_semaphore, signal_value);
         vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, instancing_pipeline.getHandle());
 
         // frame_uniform_buffer_set will still be bound
 
-        {
-            VkDeviceSize offset{0};
-            VkBuffer buffer = instance_transforms_buffer.getBuffer();
-            vkCmdBindVertexBuffers(cmd, 1, 1, &buffer, &offset);
-        }
+        auto record_instanced_draws = [&](std::span<const WorldInstancedDrawEntry> entries, RenderBuffer& transforms_buffer) {
+            {
+                VkDeviceSize offset{0};
+                VkBuffer buffer = transforms_buffer.getBuffer();
+                vkCmdBindVertexBuffers(cmd, 1, 1, &buffer, &offset);
+            }
 
-        // render instanced draws
-        for (const auto& entry : draw_data.getInstancedDrawEntries()) {
-            GC_ASSERT(entry.mesh);
-            GC_ASSERT(entry.material);
-
-            if (entry.mesh->isUploaded() && entry.material->isUploaded()) {
-                if (last_bound_material != entry.material) {
-                    entry.material->bind(cmd, instancing_pipeline_layout, timeline_semaphore, signal_value);
-                    last_bound_material = entry.material;
-                }
+            for (const auto& entry : entries) {
+                GC_ASSERT(entry.mesh);
+                GC_ASSERT(entry.material);
 
-                if (last_bound_mesh != entry.mesh) {
-                    entry.mesh->bind(cmd, timeline_semaphore, signal_value);
-                    last_bound_mesh = entry.mesh;
-                }
+                if (entry.mesh->isUploaded() && entry.material->isUploaded()) {
+                    if (last_bound_material != entry.material) {
+                        entry.material->bind(cmd, instancing_pipeline_layout, timeline_semaphore, signal_value);
+                        last_bound_material = entry.material;
+                    }
 
-                vkCmdDrawIndexed(cmd, entry.mesh->getNumIndices(), entry.instance_count, 0, 0, entry.transform_offset);
+                    if (last_bound_mesh != entry.mesh) {
+                        entry.mesh->bind(cmd, timeline_semaphore, signal_value);
+                        last_bound_mesh = entry.mesh;
+                    }
+
+                    vkCmdDrawIndexed(cmd, entry.mesh->getNumIndices(), entry.instance_count, 0, 0, entry.transform_offset);
+                }
             }
+        };
+
+        // render instanced draws
+        if (!draw_data.getInstancedDrawEntries().empty()) {
+            record_instanced_draws(draw_data.getInstancedDrawEntries(), instance_transforms_buffer);
+        }
+
+        // render static draws, their transforms stay in static_instance_transforms_buffer between frames
+        if (has_static_draws) {
+            static_instance_transforms_buffer.useResource(timeline_semaphore, signal_value);
+            record_instanced_draws(static_batches->entries, static_instance_transforms_buffer);
         }
     }
 }
@@ -1,6 +1,21 @@
 #include "gamecore/gc_threading.h"
 
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <system_error>
 #include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <sched.h>
+#elif defined(_WIN32)
+#include <Windows.h>
+#endif
 
 namespace gc {
 
@@ -11,4 +26,206 @@ bool isMainThread()
     return std::this_thread::get_id() == main_thread_id;
 }
 
+#if defined(__linux__)
+
+static bool readSysFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path);
+    return static_cast<bool>(std::getline(file, contents));
+}
+
+// returns false if the string doesn't start with a number
+template <typename T>
+static bool parseNumber(std::string_view str, T& value)
+{
+    return std::from_chars(str.data(), str.data() + str.size(), value).ec == std::errc{};
+}
+
+// parses the kernel's cpu list format, e.g. "0-3,8,10-11"
+static std::vector<unsigned int> parseCPUList(const std::string& list)
+{
+    std::vector<unsigned int> cpus{};
+    std::size_t pos = 0;
+    while (pos < list.size()) {
+        std::size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const std::string_view range = std::string_view(list).substr(pos, end - pos);
+        const std::size_t dash = range.find('-');
+        unsigned int first{};
+        unsigned int last{};
+        if (parseNumber(range.substr(0, dash), first)) {
+            if (dash == std::string_view::npos || !parseNumber(range.substr(dash + 1), last)) {
+                last = first;
+            }
+            for (unsigned int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+static CPUTopology queryCPUTopology()
+{
+    CPUTopology topology{};
+
+    cpu_set_t allowed{};
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return topology;
+    }
+
+    // Intel hybrid CPUs list their E-cores here, ARM big.LITTLE reports a lower cpu_capacity for LITTLE cores
+    std::vector<unsigned int> atom_cpus{};
+    if (std::string list{}; readSysFile("/sys/devices/cpu_atom/cpus", list)) {
+        atom_cpus = parseCPUList(list);
+    }
+
+    struct LogicalCPU {
+        unsigned int cpu;
+        int package;
+        int core;
+        unsigned long capacity;
+    };
+    std::vector<LogicalCPU> logical_cpus{};
+    unsigned long max_capacity = 0;
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        const std::string topology_dir = std::format("/sys/devices/system/cpu/cpu{}/topology/", cpu);
+        LogicalCPU logical{cpu, -1, -1 - static_cast<int>(cpu), 0}; // unknown cores are unique
+        std::string value{};
+        if (readSysFile(topology_dir + "physical_package_id", value)) {
+            parseNumber(value, logical.package);
+        }
+        if (readSysFile(topology_dir + "core_id", value)) {
+            parseNumber(value, logical.core);
+        }
+        if (readSysFile(std::format("/sys/devices/system/cpu/cpu{}/cpu_capacity", cpu), value)) {
+            parseNumber(value, logical.capacity);
+        }
+        max_capacity = std::max(max_capacity, logical.capacity);
+        logical_cpus.push_back(logical);
+    }
+
+    std::map<std::pair<int, int>, std::size_t> core_indices{}; // (package, core) to index in topology.cores
+    for (const LogicalCPU& logical : logical_cpus) {
+        const auto [it, inserted] = core_indices.try_emplace({logical.package, logical.core}, topology.cores.size());
+        if (inserted) {
+            const bool is_atom = std::ranges::find(atom_cpus, logical.cpu) != atom_cpus.end();
+            topology.cores.push_back(CPUCore{{}, is_atom || logical.capacity < max_capacity});
+        }
+        topology.cores[it->second].logical_cpus.push_back(logical.cpu);
+    }
+
+    return topology;
+}
+
+bool pinCurrentThreadToCPU(unsigned int logical_cpu)
+{
+    if (logical_cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set{};
+    CPU_ZERO(&set);
+    CPU_SET(logical_cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+#elif defined(_WIN32)
+
+static CPUTopology queryCPUTopology()
+{
+    CPUTopology topology{};
+
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+    std::vector<std::byte> buffer(length);
+    auto* const infos = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data());
+    if (length == 0 || !GetLogicalProcessorInformationEx(RelationProcessorCore, infos, &length)) {
+        return topology;
+    }
+
+    // a higher efficiency class means a faster core, every core has the same class on non-hybrid CPUs
+    std::vector<BYTE> efficiency_classes{};
+    for (DWORD offset = 0; offset < length;) {
+        const auto* const info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+        CPUCore core{};
+        for (WORD group = 0; group < info->Processor.GroupCount; ++group) {
+            const GROUP_AFFINITY& affinity = info->Processor.GroupMask[group];
+            for (unsigned int bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit) {
+                if ((affinity.Mask >> bit) & 1) {
+                    core.logical_cpus.push_back(affinity.Group * static_cast<unsigned int>(sizeof(KAFFINITY) * 8) + bit);
+                }
+            }
+        }
+        topology.cores.push_back(std::move(core));
+        efficiency_classes.push_back(info->Processor.EfficiencyClass);
+        offset += info->Size;
+    }
+
+    const BYTE max_class = *std::ranges::max_element(efficiency_classes);
+    for (std::size_t i = 0; i < topology.cores.size(); ++i) {
+        topology.cores[i].efficiency = efficiency_classes[i] < max_class;
+    }
+
+    return topology;
+}
+
+bool pinCurrentThreadToCPU([[maybe_unused]] unsigned int logical_cpu) { return false; }
+
+#else
+
+static CPUTopology queryCPUTopology() { return {}; }
+
+bool pinCurrentThreadToCPU([[maybe_unused]] unsigned int logical_cpu) { return false; }
+
+#endif
+
+const CPUTopology& getCPUTopology()
+{
+    static const CPUTopology s_topology = [] {
+        CPUTopology topology = queryCPUTopology();
+        std::erase_if(topology.cores, [](const CPUCore& core) { return core.logical_cpus.empty(); });
+        if (topology.cores.empty()) {
+            for (unsigned int cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+                topology.cores.push_back(CPUCore{{cpu}, false});
+            }
+        }
+
+        for (CPUCore& core : topology.cores) {
+            std::ranges::sort(core.logical_cpus);
+        }
+        std::ranges::stable_sort(topology.cores, [](const CPUCore& a, const CPUCore& b) {
+            return std::make_pair(a.efficiency, a.logical_cpus.front()) < std::make_pair(b.efficiency, b.logical_cpus.front());
+        });
+
+        topology.logical_cpu_count = 0;
+        topology.performance_core_count = 0;
+        for (const CPUCore& core : topology.cores) {
+            topology.logical_cpu_count += static_cast<unsigned int>(core.logical_cpus.size());
+            topology.performance_core_count += core.efficiency ? 0 : 1;
+        }
+        return topology;
+    }();
+    return s_topology;
+}
+
+std::vector<unsigned int> getCPUPlacementOrder(const CPUTopology& topology)
+{
+    std::vector<unsigned int> order{};
+    order.reserve(topology.logical_cpu_count);
+    // cores are already sorted performance first
+    for (const CPUCore& core : topology.cores) {
+        order.push_back(core.logical_cpus.front());
+    }
+    for (const CPUCore& core : topology.cores) {
+        order.insert(order.end(), core.logical_cpus.begin() + 1, core.logical_cpus.end());
+    }
+    return order;
+}
+
 } // namespace gc
@@ -0,0 +1,30 @@
+#include "gamecore/gc_transform_math.h"
+
+namespace gc {
+
+glm::mat4 composeTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    const glm::quat& q = rotation;
+    const float xx = 2.0f * q.x * q.x, yy = 2.0f * q.y * q.y, zz = 2.0f * q.z * q.z;
+    const float xy = 2.0f * q.x * q.y, xz = 2.0f * q.x * q.z, yz = 2.0f * q.y * q.z;
+    const float wx = 2.0f * q.w * q.x, wy = 2.0f * q.w * q.y, wz = 2.0f * q.w * q.z;
+
+    glm::mat4 m;
+    m[0] = glm::vec4((1.0f - (yy + zz)) * scale.x, (xy + wz) * scale.x, (xz - wy) * scale.x, 0.0f);
+    m[1] = glm::vec4((xy - wz) * scale.y, (1.0f - (xx + zz)) * scale.y, (yz + wx) * scale.y, 0.0f);
+    m[2] = glm::vec4((xz + wy) * scale.z, (yz - wx) * scale.z, (1.0f - (xx + yy)) * scale.z, 0.0f);
+    m[3] = glm::vec4(position.x, position.y, position.z, 1.0f);
+    return m;
+}
+
+glm::mat4 multiplyAffine(const glm::mat4& parent, const glm::mat4& local)
+{
+    glm::mat4 result;
+    for (int column = 0; column < 4; ++column) {
+        result[column] = local[column][0] * parent[0] + local[column][1] * parent[1] + local[column][2] * parent[2];
+    }
+    result[3] = result[3] + parent[3];
+    return result;
+}
+
+} // namespace gc
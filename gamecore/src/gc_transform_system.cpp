@@ -1,15 +1,73 @@
 #include "gamecore/gc_transform_system.h"
 
 #include <algorithm>
+#include <atomic>
+#include <vector>
 
 #include <tracy/Tracy.hpp>
 
+#include "gamecore/gc_frame_arena.h"
 #include "gamecore/gc_transform_component.h"
+#include "gamecore/gc_transform_math.h"
 #include "gamecore/gc_world.h"
 #include "gamecore/gc_frame_state.h"
 
 namespace gc {
 
+// Adds the entity to the end of the key's list in a name index and returns its slot
+template <typename Map, typename Key>
+static uint32_t addIndexEntry(Map& index, const Key& key, Entity entity)
+{
+    auto& entry = index[key];
+    entry.entities.push_back(entity);
+    ++entry.count;
+    return static_cast<uint32_t>(entry.entities.size() - 1);
+}
+
+// Removes the entity from the key's list in amortised O(1). Slot is the TransformComponent member holding each entity's slot in this index.
+template <auto Slot, typename Map, typename Key>
+static void eraseIndexEntry(Map& index, const Key& key, Entity entity, ComponentArray<TransformComponent, ComponentArrayType::DENSE>& transforms)
+{
+    auto it = index.find(key);
+    GC_ASSERT(it != index.end() && "Entity missing from name index");
+    auto& entry = it->second;
+    const uint32_t slot = transforms.get(entity).*Slot;
+    GC_ASSERT(slot < entry.entities.size() && entry.entities[slot] == entity && "Entity missing from name index");
+
+    if (--entry.count == 0) {
+        index.erase(it);
+        return;
+    }
+
+    // Leaving a gap keeps the order the entities were added in, which decides what lookups return
+    entry.entities[slot] = ENTITY_NONE;
+    while (entry.entities[entry.first] == ENTITY_NONE) {
+        ++entry.first;
+    }
+
+    // Compacting moves every entity in the list, so it is only done once there are as many gaps as entities
+    if (entry.count * 2 <= entry.entities.size()) {
+        uint32_t new_slot = 0;
+        for (Entity e : entry.entities) {
+            if (e != ENTITY_NONE) {
+                entry.entities[new_slot] = e;
+                transforms.get(e).*Slot = new_slot;
+                ++new_slot;
+            }
+        }
+        entry.entities.resize(new_slot);
+        entry.first = 0;
+    }
+}
+
+// Returns the earliest entity added under the key that is still there
+template <typename Map, typename Key>
+static Entity findIndexEntry(const Map& index, const Key& key)
+{
+    auto it = index.find(key);
+    return (it == index.end()) ? ENTITY_NONE : it->second.entities[it->second.first];
+}
+
 TransformSystem::TransformSystem(gc::World& world) : gc::System(world) {}
 
 void TransformSystem::onUpdate(FrameState& frame_state)
@@ -18,70 +76,467 @@ void TransformSystem::onUpdate(FrameState& frame_state)
 
     (void)frame_state;
 
-    m_world.forEach<TransformComponent>([&]([[maybe_unused]] Entity entity, TransformComponent& t) {
-        if (t.m_dirty) {
-            // t.m_dirty is reset by updateWorldMatricesRecursively()
-            if (t.m_parent == ENTITY_NONE) {
-                updateWorldMatricesRecursively(entity);
-            }
-            else {
-                auto parent_transform = m_world.getComponent<TransformComponent>(t.m_parent);
-                GC_ASSERT(parent_transform);
-                updateWorldMatricesRecursively(entity, parent_transform->m_world_matrix);
+    // Appended nodes are always swept so rebuild once there are a lot of them
+    const auto hierarchy_size = static_cast<uint32_t>(m_hierarchy.size());
+    if (hierarchy_size - m_sorted_count > std::max(MIN_BATCH_SIZE, hierarchy_size / 32)) {
+        rebuildHierarchy();
+    }
+    else if (m_tombstone_count > std::max(MIN_BATCH_SIZE, hierarchy_size / 4)) {
+        // tombstones are skipped but still make the swept ranges longer
+        compactHierarchy();
+    }
+
+    // Setting m_dirty requires mutable access so if nothing has a newer change tick, nothing is dirty
+    auto& transforms = m_world.getDenseComponentArray<TransformComponent>();
+    if (transforms.getMaxChangeTick() > m_last_update_tick) {
+        const uint32_t change_tick = m_world.getChangeTick();
+        m_node_update_ticks.resize(m_hierarchy.size());
+
+        findDirtyRanges();
+
+        std::atomic<bool> any_updated = false;
+        auto update_batch = [&](HierarchyRange batch) {
+            for (uint32_t i = batch.begin; i < batch.end; ++i) {
+                if (updateWorldMatrices(m_dirty_ranges[i].begin, m_dirty_ranges[i].end, change_tick)) {
+                    any_updated.store(true, std::memory_order_relaxed);
+                }
             }
+        };
+        if (m_batches.size() == 1) {
+            update_batch(m_batches[0]);
         }
-    });
+        else if (m_batches.size() > 1) {
+            Jobs& jobs = m_world.getJobs();
+            jobs.wait(jobs.dispatch(static_cast<unsigned int>(m_batches.size()), 1, [&](JobDispatchArgs args) { update_batch(m_batches[args.job_index]); }));
+        }
+        // appended nodes can have parents in any range
+        if (updateWorldMatrices(m_sorted_count, static_cast<uint32_t>(m_hierarchy.size()), change_tick)) {
+            any_updated = true;
+        }
+
+        if (any_updated) {
+            transforms.setMaxChangeTick(change_tick);
+        }
+    }
+
+    m_last_update_tick = m_world.getChangeTick();
 }
 
 void TransformSystem::setParent(Entity entity, Entity parent)
 {
     TransformComponent* entity_transform = m_world.getComponent<TransformComponent>(entity);
     GC_ASSERT(entity_transform);
+    GC_ASSERT((!entity_transform->m_static || isStaticOrRoot(parent)) && "Static entities must have static parents");
+    auto& transforms = m_world.getDenseComponentArray<TransformComponent>();
+
+    unlinkFromParent(*entity_transform);
+    eraseIndexEntry<&TransformComponent::m_child_name_slot>(m_child_name_index, getChildKey(entity_transform->m_parent, entity_transform->m_name), entity,
+                                                            transforms);
+
+    entity_transform->m_child_name_slot = addIndexEntry(m_child_name_index, getChildKey(parent, entity_transform->m_name), entity);
+    linkToParent(entity, *entity_transform, parent);
+
+    entity_transform->m_dirty = true;
+
+    // Reparenting an appended leaf under an entity that comes before it keeps the order valid
+    const TransformComponent* parent_transform = m_world.getComponent<const TransformComponent>(parent);
+    const uint32_t parent_index = parent_transform ? parent_transform->m_hierarchy_index : NO_PARENT;
+    const uint32_t index = entity_transform->m_hierarchy_index;
+    if (entity_transform->m_first_child == ENTITY_NONE && index >= m_sorted_count && (parent_index == NO_PARENT || parent_index < index)) {
+        m_hierarchy[entity_transform->m_hierarchy_index].parent_index = parent_index;
+    }
+    else {
+        // Move the subtree to the end in depth-first order, so each node's parent is appended before it
+        m_moved_subtree.clear();
+        getSubtree(entity, m_moved_subtree);
+        for (Entity moved : m_moved_subtree) {
+            TransformComponent& t = transforms.get(moved);
+            m_hierarchy[t.m_hierarchy_index].entity = ENTITY_NONE;
+            appendToHierarchy(moved, t);
+        }
+        m_tombstone_count += static_cast<uint32_t>(m_moved_subtree.size());
+    }
+}
+
+void TransformSystem::setName(Entity entity, Name name)
+{
+    TransformComponent* t = m_world.getComponent<TransformComponent>(entity);
+    GC_ASSERT(t);
+    auto& transforms = m_world.getDenseComponentArray<TransformComponent>();
+
+    eraseIndexEntry<&TransformComponent::m_name_slot>(m_name_index, t->m_name, entity, transforms);
+    eraseIndexEntry<&TransformComponent::m_child_name_slot>(m_child_name_index, getChildKey(t->m_parent, t->m_name), entity, transforms);
+    t->m_name = name;
+    t->m_name_slot = addIndexEntry(m_name_index, name, entity);
+    t->m_child_name_slot = addIndexEntry(m_child_name_index, getChildKey(t->m_parent, name), entity);
+}
+
+void TransformSystem::setStatic(Entity root, bool is_static)
+{
+    // A static entity under a moving parent would have its world matrix change, and the static batches rebaked, whenever the parent moved
+    GC_ASSERT((!is_static || isStaticOrRoot(m_world.getComponent<const TransformComponent>(root)->m_parent)) && "Static entities must have static parents");
+
+    FrameVector<Entity> entities{};
+    getSubtree(root, entities);
+    for (Entity entity : entities) {
+        // mutable access so systems relying on the change tick, like RenderSystem, see the change
+        m_world.getComponent<TransformComponent>(entity)->m_static = is_static;
+    }
+}
+
+void TransformSystem::onEntityCreated(Entity entity, Name name, Entity parent)
+{
+    TransformComponent* t = m_world.getComponent<TransformComponent>(entity);
+    GC_ASSERT(t);
+    GC_ASSERT(t->m_parent == ENTITY_NONE);
+
+    t->m_name = name;
+    t->m_name_slot = addIndexEntry(m_name_index, name, entity);
+    t->m_child_name_slot = addIndexEntry(m_child_name_index, getChildKey(parent, name), entity);
+    linkToParent(entity, *t, parent);
+    appendToHierarchy(entity, *t);
+}
+
+void TransformSystem::onEntitiesCreated(std::span<const Entity> entities, Name name, Entity parent)
+{
+    if (entities.empty()) {
+        return;
+    }
+
+    // every entity goes under the same two keys
+    const uint64_t child_key = getChildKey(parent, name);
+    std::vector<Entity>& named = m_name_index[name].entities;
+    named.reserve(named.size() + entities.size());
+    std::vector<Entity>& children = m_child_name_index[child_key].entities;
+    children.reserve(children.size() + entities.size());
+
+    for (Entity entity : entities) {
+        TransformComponent* t = m_world.getComponent<TransformComponent>(entity);
+        GC_ASSERT(t);
+        GC_ASSERT(t->m_parent == ENTITY_NONE);
+
+        t->m_name = name;
+        t->m_dirty = true;
+        t->m_name_slot = addIndexEntry(m_name_index, name, entity);
+        t->m_child_name_slot = addIndexEntry(m_child_name_index, child_key, entity);
+        linkToParent(entity, *t, parent);
+        appendToHierarchy(entity, *t);
+    }
+}
+
+void TransformSystem::onEntitiesCreated(std::span<const Entity> entities, Name name, std::span<const Entity> parents)
+{
+    GC_ASSERT(entities.size() == parents.size());
+
+    if (entities.empty()) {
+        return;
+    }
+
+    // every entity shares a name, but there is a child key per parent
+    std::vector<Entity>& named = m_name_index[name].entities;
+    named.reserve(named.size() + entities.size());
+    m_child_name_index.reserve(m_child_name_index.size() + entities.size());
+
+    for (std::size_t i = 0; i < entities.size(); ++i) {
+        TransformComponent* t = m_world.getComponent<TransformComponent>(entities[i]);
+        GC_ASSERT(t);
+        GC_ASSERT(t->m_parent == ENTITY_NONE);
+
+        t->m_name = name;
+        t->m_dirty = true;
+        t->m_name_slot = addIndexEntry(m_name_index, name, entities[i]);
+        t->m_child_name_slot = addIndexEntry(m_child_name_index, getChildKey(parents[i], name), entities[i]);
+        linkToParent(entities[i], *t, parents[i]);
+        appendToHierarchy(entities[i], *t);
+    }
+}
+
+void TransformSystem::reserve(uint32_t count)
+{
+    m_name_index.reserve(m_name_index.size() + count);
+    m_child_name_index.reserve(m_child_name_index.size() + count);
+}
+
+void TransformSystem::onSubtreeDestroyed(Entity root, std::span<const Entity> entities)
+{
+    GC_ASSERT(!entities.empty() && entities[0] == root);
+
+    // Nothing here depends on the number of entities in the world or in the indices, so destroying a single entity is cheap
+    auto& transforms = m_world.getDenseComponentArray<TransformComponent>();
+    for (Entity entity : entities) {
+        const TransformComponent& t = transforms.get(entity);
+        eraseIndexEntry<&TransformComponent::m_name_slot>(m_name_index, t.m_name, entity, transforms);
+        eraseIndexEntry<&TransformComponent::m_child_name_slot>(m_child_name_index, getChildKey(t.m_parent, t.m_name), entity, transforms);
+        m_hierarchy[t.m_hierarchy_index].entity = ENTITY_NONE;
+    }
 
-    if (entity_transform->m_parent != ENTITY_NONE) {
-        // remove entity from old parent's children array
-        GC_ASSERT(m_parent_children.contains(entity_transform->m_parent));
-        auto& previous_parents_children = m_parent_children[entity_transform->m_parent];
-        auto it = std::find(previous_parents_children.cbegin(), previous_parents_children.cend(), entity);
-        GC_ASSERT(it != previous_parents_children.cend());
-        previous_parents_children.erase(it);
+    // links between entities inside the subtree are destroyed along with it
+    unlinkFromParent(transforms.get(root));
+
+    // The subtree's nodes are left as tombstones rather than rebuilding the hierarchy
+    m_tombstone_count += static_cast<uint32_t>(entities.size());
+}
+
+template <typename Allocator>
+void TransformSystem::getSubtree(Entity root, std::vector<Entity, Allocator>& out) const
+{
+    // Walks the sibling links depth first so no stack is needed
+    Entity current = root;
+    while (current != ENTITY_NONE) {
+        out.push_back(current);
+        const TransformComponent* t = m_world.getComponent<const TransformComponent>(current);
+        GC_ASSERT(t);
+        if (t->m_first_child != ENTITY_NONE) {
+            current = t->m_first_child;
+            continue;
+        }
+        // climb back up to the nearest ancestor that has a next sibling
+        while (current != root && t->m_next_sibling == ENTITY_NONE) {
+            current = t->m_parent;
+            t = m_world.getComponent<const TransformComponent>(current);
+        }
+        current = (current == root) ? ENTITY_NONE : t->m_next_sibling;
+    }
+}
+
+template void TransformSystem::getSubtree(Entity root, std::vector<Entity>& out) const;
+template void TransformSystem::getSubtree(Entity root, FrameVector<Entity>& out) const;
+
+Entity TransformSystem::findEntity(Name name) const { return findIndexEntry(m_name_index, name); }
+
+Entity TransformSystem::findChild(Entity parent, Name name) const { return findIndexEntry(m_child_name_index, getChildKey(parent, name)); }
+
+Entity TransformSystem::findEntityByPath(std::string_view path, Entity root) const
+{
+    Entity current = root;
+    while (!path.empty()) {
+        const std::size_t separator = path.find('/');
+        const std::string_view segment = path.substr(0, separator);
+        path = (separator == std::string_view::npos) ? std::string_view{} : path.substr(separator + 1);
+        if (segment.empty()) {
+            continue;
+        }
+        current = findChild(current, Name(segment));
+        if (current == ENTITY_NONE) {
+            break;
+        }
     }
+    return current;
+}
+
+bool TransformSystem::isStaticOrRoot(Entity parent) const
+{
+    return parent == ENTITY_NONE || m_world.getComponent<const TransformComponent>(parent)->m_static;
+}
+
+void TransformSystem::linkToParent(Entity entity, TransformComponent& t, Entity parent)
+{
+    GC_ASSERT(t.m_prev_sibling == ENTITY_NONE && t.m_next_sibling == ENTITY_NONE);
 
+    t.m_parent = parent;
     if (parent != ENTITY_NONE) {
-        // add entity to new parent's children array
-        if (auto it = m_parent_children.find(parent); it != m_parent_children.end()) {
-            it->second.push_back(entity);
+        TransformComponent* parent_transform = m_world.getComponent<TransformComponent>(parent);
+        GC_ASSERT(parent_transform);
+        if (parent_transform->m_first_child != ENTITY_NONE) {
+            m_world.getComponent<TransformComponent>(parent_transform->m_first_child)->m_prev_sibling = entity;
         }
-        else {
-            m_parent_children.insert({parent, {entity}});
+        t.m_next_sibling = parent_transform->m_first_child;
+        parent_transform->m_first_child = entity;
+    }
+}
+
+void TransformSystem::unlinkFromParent(TransformComponent& t)
+{
+    if (t.m_parent == ENTITY_NONE) {
+        return;
+    }
+
+    if (t.m_prev_sibling != ENTITY_NONE) {
+        m_world.getComponent<TransformComponent>(t.m_prev_sibling)->m_next_sibling = t.m_next_sibling;
+    }
+    else {
+        m_world.getComponent<TransformComponent>(t.m_parent)->m_first_child = t.m_next_sibling;
+    }
+    if (t.m_next_sibling != ENTITY_NONE) {
+        m_world.getComponent<TransformComponent>(t.m_next_sibling)->m_prev_sibling = t.m_prev_sibling;
+    }
+    t.m_prev_sibling = ENTITY_NONE;
+    t.m_next_sibling = ENTITY_NONE;
+}
+
+void TransformSystem::appendToHierarchy(Entity entity, TransformComponent& t)
+{
+    uint32_t parent_index = NO_PARENT;
+    if (t.m_parent != ENTITY_NONE) {
+        const TransformComponent* parent_transform = m_world.getComponent<const TransformComponent>(t.m_parent);
+        GC_ASSERT(parent_transform);
+        parent_index = parent_transform->m_hierarchy_index;
+    }
+    t.m_hierarchy_index = static_cast<uint32_t>(m_hierarchy.size());
+    m_hierarchy.emplace_back(entity, parent_index, t.m_hierarchy_index + 1);
+}
+
+void TransformSystem::rebuildHierarchy()
+{
+    ZoneScoped;
+
+    std::vector<Entity> entities{};
+    entities.reserve(m_hierarchy.size());
+    m_world.forEach<const TransformComponent>([&](Entity entity, const TransformComponent& t) {
+        if (t.m_parent == ENTITY_NONE) {
+            getSubtree(entity, entities);
         }
+    });
+
+    auto& transforms = m_world.getDenseComponentArray<TransformComponent>();
+    const auto count = static_cast<uint32_t>(entities.size());
+    m_hierarchy.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        TransformComponent& t = transforms.get(entities[i]);
+        t.m_hierarchy_index = i;
+        m_hierarchy[i].entity = entities[i];
+        m_hierarchy[i].parent_index = (t.m_parent == ENTITY_NONE) ? NO_PARENT : transforms.get(t.m_parent).m_hierarchy_index;
+        m_hierarchy[i].subtree_end = i + 1;
     }
+    // children come after their parents so going backwards, each node's subtree_end is final before it is passed up
+    for (uint32_t i = count; i-- > 0;) {
+        const uint32_t parent_index = m_hierarchy[i].parent_index;
+        if (parent_index != NO_PARENT) {
+            m_hierarchy[parent_index].subtree_end = std::max(m_hierarchy[parent_index].subtree_end, m_hierarchy[i].subtree_end);
+        }
+    }
+    m_sorted_count = count;
+    m_tombstone_count = 0;
 
-    entity_transform->m_dirty = true;
-    entity_transform->m_parent = parent;
+    // indices have moved so old ticks don't mean anything
+    m_node_update_ticks.assign(count, 0);
 }
 
-void TransformSystem::updateWorldMatricesRecursively(const Entity entity, const glm::mat4& parent_matrix)
+void TransformSystem::compactHierarchy()
 {
-    // GC_TRACE("Updating world matrix for {}", entity);
+    ZoneScoped;
 
-    TransformComponent* t = m_world.getComponent<TransformComponent>(entity);
-    GC_ASSERT(t);
+    // new_indices[i] is the number of live nodes before i, which is where node i moves to if it is live.
+    // Taking it for one past the end of a subtree gives one past the end of the compacted subtree.
+    const auto size = static_cast<uint32_t>(m_hierarchy.size());
+    std::vector<uint32_t> new_indices(size + 1);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        new_indices[i] = count;
+        count += (m_hierarchy[i].entity != ENTITY_NONE) ? 1 : 0;
+    }
+    new_indices[size] = count;
+
+    // nodes only move backwards so this can be done in place
+    auto& transforms = m_world.getDenseComponentArray<TransformComponent>();
+    for (uint32_t i = 0; i < size; ++i) {
+        const HierarchyNode node = m_hierarchy[i];
+        if (node.entity == ENTITY_NONE) {
+            continue;
+        }
+        const uint32_t new_index = new_indices[i];
+        const uint32_t parent_index = (node.parent_index == NO_PARENT) ? NO_PARENT : new_indices[node.parent_index];
+        m_hierarchy[new_index] = HierarchyNode{node.entity, parent_index, new_indices[node.subtree_end]};
+        transforms.get(node.entity).m_hierarchy_index = new_index;
+    }
+    m_hierarchy.resize(count);
+    m_sorted_count = new_indices[m_sorted_count];
+    m_tombstone_count = 0;
+
+    m_node_update_ticks.assign(count, 0);
+}
+
+void TransformSystem::findDirtyRanges()
+{
+    ZoneScoped;
+
+    // Only blocks of the transform array with a newer change tick are looked at, and only dirty transforms in those
+    auto& transforms = m_world.getDenseComponentArray<TransformComponent>();
+    const std::span<const uint32_t> ticks = transforms.getChangeTicks();
+    const std::span<const uint32_t> block_ticks = transforms.getBlockChangeTicks();
+    constexpr std::size_t BLOCK_SIZE = IComponentArray::CHANGE_TICK_BLOCK_SIZE;
+
+    m_dirty_nodes.clear();
+    for (std::size_t block = 0; block * BLOCK_SIZE < ticks.size(); ++block) {
+        if (block_ticks[block] <= m_last_update_tick) {
+            continue;
+        }
+        const std::size_t block_end = std::min((block + 1) * BLOCK_SIZE, ticks.size());
+        for (auto entity = static_cast<Entity>(block * BLOCK_SIZE); entity < block_end; ++entity) {
+            if (ticks[entity] <= m_last_update_tick || !m_world.isAlive(entity)) {
+                continue;
+            }
+            const TransformComponent& t = transforms.get(entity);
+            if (t.m_dirty && t.m_hierarchy_index < m_sorted_count) {
+                m_dirty_nodes.push_back(t.m_hierarchy_index);
+            }
+        }
+    }
+
+    // Dirty nodes inside the subtree of another dirty node are covered by that node's range
+    std::ranges::sort(m_dirty_nodes);
+    m_dirty_ranges.clear();
+    uint32_t total_size = 0;
+    for (uint32_t index : m_dirty_nodes) {
+        if (!m_dirty_ranges.empty() && index < m_dirty_ranges.back().end) {
+            continue;
+        }
+        m_dirty_ranges.emplace_back(index, m_hierarchy[index].subtree_end);
+        total_size += m_hierarchy[index].subtree_end - index;
+    }
+
+    // Ranges don't depend on each other. Group them into a few batches per thread.
+    const uint32_t target_size = std::max(MIN_BATCH_SIZE, total_size / (m_world.getJobs().getNumThreads() * 4));
+    m_batches.clear();
+    uint32_t batch_begin = 0;
+    uint32_t batch_size = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_dirty_ranges.size()); ++i) {
+        batch_size += m_dirty_ranges[i].end - m_dirty_ranges[i].begin;
+        if (batch_size >= target_size || i + 1 == m_dirty_ranges.size()) {
+            m_batches.emplace_back(batch_begin, i + 1);
+            batch_begin = i + 1;
+            batch_size = 0;
+        }
+    }
+}
+
+bool TransformSystem::updateWorldMatrices(uint32_t begin, uint32_t end, uint32_t change_tick)
+{
+    ZoneScoped;
+
+    // Only touches nodes in the range and the entities' own change ticks, so separate ranges can be updated concurrently
+    auto& transforms = m_world.getDenseComponentArray<TransformComponent>();
+    bool any_updated = false;
 
-    glm::mat4 local_matrix = glm::mat4_cast(t->m_rotation);
-    local_matrix[3][0] = t->m_position.x;
-    local_matrix[3][1] = t->m_position.y;
-    local_matrix[3][2] = t->m_position.z;
-    local_matrix = glm::scale(local_matrix, t->m_scale);
-    t->m_world_matrix = parent_matrix * local_matrix;
+    for (uint32_t i = begin; i < end; ++i) {
+        const HierarchyNode node = m_hierarchy[i];
+        if (node.entity == ENTITY_NONE) {
+            continue;
+        }
+        TransformComponent& t = transforms.get(node.entity);
 
-    t->m_dirty = false;
+        // a child is recomputed whenever its parent was, parents always come first so their tick is already set
+        const bool parent_updated = node.parent_index != NO_PARENT && m_node_update_ticks[node.parent_index] == change_tick;
+        if (!t.m_dirty && !parent_updated) {
+            continue;
+        }
+        m_node_update_ticks[i] = change_tick;
 
-    if (auto it = m_parent_children.find(entity); it != m_parent_children.end()) {
-        for (Entity child : it->second) {
-            updateWorldMatricesRecursively(child, t->m_world_matrix);
+        // The parent is applied straight away while the local matrix is still in registers. Composing local matrices 4 at a time with SSE
+        // and applying parents in a second pass was slower, as gathering each transform's members into SIMD lanes cost more than it saved.
+        const glm::mat4 local_matrix = composeTransform(t.m_position, t.m_rotation, t.m_scale);
+        if (node.parent_index == NO_PARENT) {
+            t.m_world_matrix = local_matrix;
         }
+        else {
+            t.m_world_matrix = multiplyAffine(transforms.get(m_hierarchy[node.parent_index].entity).m_world_matrix, local_matrix);
+        }
+        t.m_dirty = false;
+        transforms.setChangeTick(node.entity, change_tick);
+        any_updated = true;
     }
+
+    return any_updated;
 }
 
 } // namespace gc
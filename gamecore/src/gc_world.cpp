@@ -3,15 +3,31 @@
 #include <tracy/Tracy.hpp>
 
 #include "gclog/gclog.h"
+#include "gamecore/gc_frame_arena.h"
 #include "gamecore/gc_transform_component.h"
 #include "gamecore/gc_transform_system.h"
+#include "gamecore/gc_world_command_buffer.h"
+#include "gamecore/gc_threading.h"
 
 namespace gc {
 
-World::World()
+// commands() caches the calling thread's buffer so it only takes the lock the first time a thread records into a World.
+// Worlds are told apart by ID rather than address since a new World may be allocated where an old one was.
+struct ThreadCommandBuffer {
+    uint64_t world_id;
+    WorldCommandBuffer* command_buffer;
+};
+static thread_local ThreadCommandBuffer t_command_buffer{};
+static std::atomic<uint64_t> s_next_world_id{1};
+
+World::World(Jobs& jobs) : m_jobs(jobs), m_id(s_next_world_id.fetch_add(1, std::memory_order_relaxed))
 {
+    // the archetype for entities without any components
+    getOrCreateArchetype(Signature{});
+
     registerComponent<TransformComponent, ComponentArrayType::DENSE>();
-    registerSystem<TransformSystem>();
+    // TransformSystem waits on the job system so it can't run as a job itself
+    registerSystemWithAccess<TransformSystem>(SystemAccess{}.writes<TransformComponent>().onMainThread());
 
     GC_TRACE("Initialised World");
 }
@@ -19,92 +35,433 @@ World::World()
 World::~World() { GC_TRACE("Destroying World..."); }
 
 Entity World::createEntity(Name name, Entity parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    GC_ASSERT(m_iteration_depth == 0 && "Cannot create entities while iterating!");
+
+    const uint32_t transform_archetype = getArchetypeTransition(0, getComponentIndex<TransformComponent>(), true);
+    const Entity entity = createEntityWithTransform(transform_archetype, position, rotation, scale);
+
+    getSystem<TransformSystem>().onEntityCreated(entity, name, parent);
+
+    return entity;
+}
+
+std::vector<Entity> World::createEntities(uint32_t count, Name name, Entity parent, const glm::vec3& position, const glm::quat& rotation,
+                                          const glm::vec3& scale)
+{
+    GC_ASSERT(m_iteration_depth == 0 && "Cannot create entities while iterating!");
+
+    std::vector<Entity> entities = createEntitiesWithTransform(count, position, rotation, scale);
+
+    getSystem<TransformSystem>().onEntitiesCreated(entities, name, parent);
+
+    return entities;
+}
+
+std::vector<Entity> World::createEntities(std::span<const Entity> parents, Name name, const glm::vec3& position, const glm::quat& rotation,
+                                          const glm::vec3& scale)
+{
+    GC_ASSERT(m_iteration_depth == 0 && "Cannot create entities while iterating!");
+
+    std::vector<Entity> entities = createEntitiesWithTransform(static_cast<uint32_t>(parents.size()), position, rotation, scale);
+
+    getSystem<TransformSystem>().onEntitiesCreated(entities, name, parents);
+
+    return entities;
+}
+
+void World::destroySubtree(const Entity root)
+{
+    ZoneScoped;
+
+    GC_ASSERT(m_iteration_depth == 0 && "Cannot delete entities while iterating!");
+    GC_ASSERT(isAlive(root));
+    GC_ASSERT(m_entity_signatures[root].hasTypes<TransformComponent>());
+
+    auto& transform_system = getSystem<TransformSystem>();
+
+    // Entities are often destroyed every frame through command buffers, so the subtree list goes on the frame arena
+    FrameVector<Entity> entities{};
+    transform_system.getSubtree(root, entities);
+
+    // remove from TransformSystem's hierarchy and name indices
+    transform_system.onSubtreeDestroyed(root, entities);
+
+    for (Entity entity : entities) {
+        // delete all components (archetype components are deleted along with the entity's archetype row)
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_component_arrays.size()); ++i) {
+            if (m_entity_signatures[entity].hasComponentIndex(i)) {
+                recordRemoval(i, entity);
+                if (m_component_arrays[i].component_array) {
+                    m_component_arrays[i].component_array->removeComponent(entity);
+                }
+            }
+        }
+
+        removeEntityFromArchetype(entity);
+
+        m_entity_signatures[entity] = Signature{}; // an empty signature in m_entity_signatures means no entity
+    }
+
+    m_free_entity_ids.insert(m_free_entity_ids.end(), entities.begin(), entities.end());
+}
+
+Entity World::findEntity(const Name name) { return getSystem<TransformSystem>().findEntity(name); }
+
+Entity World::findChild(const Entity parent, const Name name) { return getSystem<TransformSystem>().findChild(parent, name); }
+
+Entity World::findEntityByPath(std::string_view path, const Entity root) { return getSystem<TransformSystem>().findEntityByPath(path, root); }
+
+void World::update(FrameState& frame_state)
+{
+    ZoneScoped;
+
+    if (m_system_stages_dirty) {
+        buildSystemStages();
+    }
+
+    // Keep last frame's removals for systems that ran before them, see forEachRemoved()
+    m_removal_log_start_tick = m_frame_start_tick;
+    m_frame_start_tick = m_change_tick;
+    for (auto& removed : m_removed_entities) {
+        removed.erase(removed.begin(), std::ranges::lower_bound(removed, m_removal_log_start_tick, {}, &std::pair<Entity, uint32_t>::second));
+    }
+
+    // Systems can register other systems in onUpdate(). Those will start running next frame.
+    for (std::size_t stage_index = 0; stage_index < m_system_stages.size(); ++stage_index) {
+        const std::vector<uint32_t>& stage = m_system_stages[stage_index];
+        if (stage.size() == 1) {
+            m_running_systems.store(true, std::memory_order_relaxed);
+            m_systems[stage[0]]->onUpdate(frame_state);
+            m_running_systems.store(false, std::memory_order_relaxed);
+            ++m_change_tick;
+            flushCommands();
+            continue;
+        }
+
+        // Prevent structural changes while systems run concurrently
+        ++m_iteration_depth;
+        m_running_systems.store(true, std::memory_order_relaxed);
+        m_system_job_handles.clear();
+        for (uint32_t system_index : stage) {
+            if (!m_system_accesses[system_index]->isMainThread()) {
+                System* const system = m_systems[system_index].get();
+                m_system_job_handles.push_back(m_jobs.execute([system, &frame_state]() { system->onUpdate(frame_state); }));
+            }
+        }
+        for (uint32_t system_index : stage) {
+            if (m_system_accesses[system_index]->isMainThread()) {
+                m_systems[system_index]->onUpdate(frame_state);
+            }
+        }
+        // only wait for this stage's systems, unrelated background jobs may still be running
+        for (const JobHandle& handle : m_system_job_handles) {
+            m_jobs.wait(handle);
+        }
+        m_running_systems.store(false, std::memory_order_relaxed);
+        --m_iteration_depth;
+
+        // Commands get the next tick so systems that have already run this frame see them as changes next frame
+        ++m_change_tick;
+        flushCommands();
+    }
+}
+
+WorldCommandBuffer& World::commands()
+{
+    // Only the main thread reads m_flushing_commands
+    GC_ASSERT(!(isMainThread() && m_flushing_commands) && "Cannot record commands while they are being applied");
+    // Nothing can flush while systems run or while something iterates, e.g. the jobs of a parallelForEach()
+    GC_ASSERT((isMainThread() || m_running_systems.load(std::memory_order_relaxed) || m_iteration_depth.load(std::memory_order_relaxed) != 0) &&
+              "Use submitCommands() from background jobs and Tasks");
+
+    if (t_command_buffer.world_id == m_id) {
+        return *t_command_buffer.command_buffer;
+    }
+
+    const std::thread::id thread_id = std::this_thread::get_id();
+    std::scoped_lock lock(m_command_buffers_mutex);
+    WorldCommandBuffer* command_buffer = nullptr;
+    for (const auto& [id, buffer] : m_command_buffers) {
+        if (id == thread_id) {
+            command_buffer = buffer.get();
+            break;
+        }
+    }
+    if (!command_buffer) {
+        command_buffer = m_command_buffers.emplace_back(thread_id, std::make_unique<WorldCommandBuffer>()).second.get();
+    }
+    t_command_buffer = ThreadCommandBuffer{m_id, command_buffer};
+    return *command_buffer;
+}
+
+void World::submitCommands(WorldCommandBuffer&& command_buffer)
+{
+    if (command_buffer.empty()) {
+        return;
+    }
+    std::scoped_lock lock(m_command_buffers_mutex);
+    m_submitted_command_buffers.push_back(std::make_unique<WorldCommandBuffer>(std::move(command_buffer)));
+}
+
+void World::flushCommands()
+{
+    GC_ASSERT(isMainThread());
+    GC_ASSERT(m_iteration_depth == 0 && "Cannot apply commands while iterating!");
+
+    // Per-thread buffers aren't recorded into while this runs, see commands().
+    // Submitted buffers are taken out under the lock so submitCommands() can carry on during the flush.
+    m_flushing_command_buffers.clear();
+    {
+        std::scoped_lock lock(m_command_buffers_mutex);
+        for (const auto& [id, command_buffer] : m_command_buffers) {
+            if (!command_buffer->empty()) {
+                m_flushing_command_buffers.push_back(command_buffer.get());
+            }
+        }
+        m_applying_command_buffers.swap(m_submitted_command_buffers);
+    }
+    for (const auto& command_buffer : m_applying_command_buffers) {
+        m_flushing_command_buffers.push_back(command_buffer.get());
+    }
+    if (m_flushing_command_buffers.empty()) {
+        return;
+    }
+
+    ZoneScoped;
+
+    m_flushing_commands = true;
+
+    // Each phase is run across every buffer so deletes, which free entity IDs, come after all creates
+    for (WorldCommandBuffer* command_buffer : m_flushing_command_buffers) {
+        command_buffer->applyCreates(*this);
+    }
+    for (WorldCommandBuffer* command_buffer : m_flushing_command_buffers) {
+        command_buffer->applyAdds(*this);
+    }
+    for (WorldCommandBuffer* command_buffer : m_flushing_command_buffers) {
+        command_buffer->applyRemoves(*this);
+    }
+    for (WorldCommandBuffer* command_buffer : m_flushing_command_buffers) {
+        command_buffer->applyDeletes(*this);
+    }
+    for (WorldCommandBuffer* command_buffer : m_flushing_command_buffers) {
+        command_buffer->clear();
+    }
+    m_applying_command_buffers.clear();
+    m_flushing_command_buffers.clear();
+
+    m_flushing_commands = false;
+}
+
+std::vector<Name> World::getComponentList(Entity entity) const
+{
+    std::vector<Name> list{};
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_component_arrays.size()); ++i) {
+        if (m_entity_signatures[entity].hasComponentIndex(i)) {
+            list.push_back(m_component_names[i]);
+        }
+    }
+    return list;
+}
+
+void World::buildSystemStages()
+{
+    // Each system goes into the stage after the last stage containing a system it conflicts with.
+    // Systems registered without a SystemAccess conflict with everything so get a stage to themselves.
+    const auto system_count = static_cast<uint32_t>(m_systems.size());
+    std::vector<uint32_t> system_stage(system_count);
+    m_system_stages.clear();
+    for (uint32_t i = 0; i < system_count; ++i) {
+        uint32_t stage = 0;
+        for (uint32_t j = 0; j < i; ++j) {
+            const bool conflicts = !m_system_accesses[i] || !m_system_accesses[j] || m_system_accesses[i]->conflictsWith(*m_system_accesses[j]);
+            if (conflicts) {
+                stage = std::max(stage, system_stage[j] + 1);
+            }
+        }
+        system_stage[i] = stage;
+        if (stage >= m_system_stages.size()) {
+            m_system_stages.resize(stage + 1);
+        }
+        m_system_stages[stage].push_back(i);
+    }
+
+    m_system_stages_dirty = false;
+
+    GC_TRACE("Scheduled {} systems into {} stages", system_count, m_system_stages.size());
+}
+
+void World::reserveEntities(uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    const auto reused_ids = static_cast<uint32_t>(std::min(m_free_entity_ids.size(), static_cast<std::size_t>(count)));
+    m_entity_signatures.reserve(m_entity_signatures.size() + count - reused_ids);
+    m_entity_locations.reserve(m_entity_locations.size() + count - reused_ids);
+
+    // new entities go straight into the archetype with just a TransformComponent
+    m_archetypes[getArchetypeTransition(0, getComponentIndex<TransformComponent>(), true)]->reserve(count);
+    m_component_arrays[getComponentIndex<TransformComponent>()].component_array->reserve(
+        count, static_cast<Entity>(m_entity_signatures.size() + count - reused_ids - 1));
+
+    getSystem<TransformSystem>().reserve(count);
+}
+
+Entity World::createEntityWithTransform(uint32_t transform_archetype, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
 {
     Entity entity{};
     if (m_free_entity_ids.empty()) {
         entity = static_cast<uint32_t>(m_entity_signatures.size());
-        m_entity_signatures.resize(m_entity_signatures.size() + 1);
+        m_entity_signatures.emplace_back();
+        m_entity_locations.emplace_back();
     }
     else {
         entity = m_free_entity_ids.back();
         m_free_entity_ids.pop_back();
-        m_entity_signatures[entity] = Signature{};
     }
 
-    TransformComponent& t = addComponent<TransformComponent>(entity);
-    t.name = name;
+    m_entity_signatures[entity] = Signature::fromTypes<TransformComponent>();
+    m_entity_locations[entity].archetype = transform_archetype;
+    m_entity_locations[entity].row = m_archetypes[transform_archetype]->addRow(entity);
+
+    auto& component_array = getDenseComponentArray<TransformComponent>();
+    component_array.addComponent(entity);
+    component_array.setChangeTick(entity, m_change_tick);
+    component_array.setMaxChangeTick(m_change_tick);
+
+    TransformComponent& t = component_array.get(entity);
     t.setPosition(position);
     t.setRotation(rotation);
     t.setScale(scale);
 
-    getSystem<TransformSystem>().setParent(entity, parent);
-
-    m_max_alive_entity_id = std::max(m_max_alive_entity_id, entity);
-
     return entity;
 }
 
-void World::deleteEntity(const Entity entity)
+std::vector<Entity> World::createEntitiesWithTransform(uint32_t count, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
 {
-    GC_ASSERT(entity < static_cast<uint32_t>(m_entity_signatures.size()));
-    GC_ASSERT(m_entity_signatures[entity].hasTypes<TransformComponent>());
+    reserveEntities(count);
 
-    auto& transform_system = getSystem<TransformSystem>();
+    const uint32_t transform_archetype = getArchetypeTransition(0, getComponentIndex<TransformComponent>(), true);
+    std::vector<Entity> entities(count);
+    for (Entity& entity : entities) {
+        entity = createEntityWithTransform(transform_archetype, position, rotation, scale);
+    }
+    return entities;
+}
 
-    // delete children:
-    auto children = transform_system.getChildren(entity);
-    for (Entity child : children) {
-        deleteEntity(child);
+void World::reserveComponents(uint32_t component_index, uint32_t count, Entity highest_entity)
+{
+    GC_ASSERT(component_index < static_cast<uint32_t>(m_component_arrays.size()));
+    // archetype components are reserved when entities move archetype
+    if (m_component_arrays[component_index].component_array) {
+        m_component_arrays[component_index].component_array->reserve(count, highest_entity);
     }
+}
 
-    // remove from TransformSystem's m_parent_children map
-    transform_system.setParent(entity, ENTITY_NONE);
+uint32_t World::getOrCreateArchetype(const Signature& signature)
+{
+    if (auto it = m_archetype_lookup.find(signature); it != m_archetype_lookup.end()) {
+        return it->second;
+    }
 
-    // delete all components
+    std::vector<ArchetypeColumnInfo> columns{};
     for (uint32_t i = 0; i < static_cast<uint32_t>(m_component_arrays.size()); ++i) {
-        if (m_entity_signatures[entity].hasComponentIndex(i)) {
-            m_component_arrays[i].component_array->removeComponent(entity);
+        if (signature.hasComponentIndex(i) && m_component_arrays[i].type == ComponentArrayType::ARCHETYPE) {
+            columns.emplace_back(i, m_component_arrays[i].component_size);
         }
     }
 
-    m_entity_signatures[entity] = Signature{}; // an empty signature in m_entity_signatures means no entity
-    m_free_entity_ids.push_back(entity);
+    const auto archetype_index = static_cast<uint32_t>(m_archetypes.size());
+    m_archetypes.push_back(std::make_unique<Archetype>(signature, columns));
+    m_archetype_lookup.emplace(signature, archetype_index);
 
-    if (m_max_alive_entity_id == entity) {
-        --m_max_alive_entity_id;
+    for (const auto& query : m_queries) {
+        if (signature.contains(query->required)) {
+            query->archetypes.push_back(m_archetypes.back().get());
+        }
     }
+
+    GC_TRACE("Created archetype {} with {} components", archetype_index, signature.componentCount());
+
+    return archetype_index;
 }
 
-Entity World::findEntity(const Name name)
+uint32_t World::getArchetypeTransition(uint32_t archetype, uint32_t component_index, bool add)
 {
-    // TODO: this is very unoptimised. It doesn't even early-return once found.
-    // Perhaps cache name->entity mappings
-    Entity found_entity{ENTITY_NONE};
-    forEach<TransformComponent>([&](Entity e, const TransformComponent& t) {
-        if (t.name == name) {
-            found_entity = e;
-        }
-    });
-    return found_entity;
+    GC_ASSERT(archetype < static_cast<uint32_t>(m_archetypes.size()));
+
+    const uint32_t cached = add ? m_archetypes[archetype]->getAddEdge(component_index) : m_archetypes[archetype]->getRemoveEdge(component_index);
+    if (cached != ARCHETYPE_NONE) {
+        return cached;
+    }
+
+    Signature signature = m_archetypes[archetype]->getSignature();
+    signature.setWithIndex(component_index, add);
+    const uint32_t result = getOrCreateArchetype(signature); // may add to m_archetypes
+
+    if (add) {
+        m_archetypes[archetype]->setAddEdge(component_index, result);
+        m_archetypes[result]->setRemoveEdge(component_index, archetype);
+    }
+    else {
+        m_archetypes[archetype]->setRemoveEdge(component_index, result);
+        m_archetypes[result]->setAddEdge(component_index, archetype);
+    }
+
+    return result;
 }
 
-void World::update(FrameState& frame_state)
+void World::moveEntityToArchetype(Entity entity, uint32_t archetype)
 {
-    ZoneScoped;
-    for (auto& system : m_systems) {
-        system->onUpdate(frame_state);
+    EntityLocation& location = m_entity_locations[entity];
+    GC_ASSERT(location.archetype != ARCHETYPE_NONE);
+    GC_ASSERT(location.archetype != archetype);
+
+    Entity moved_entity{};
+    const uint32_t new_row = m_archetypes[location.archetype]->moveRow(location.row, *m_archetypes[archetype], moved_entity);
+    if (moved_entity != ENTITY_NONE) {
+        m_entity_locations[moved_entity].row = location.row;
     }
+
+    location.archetype = archetype;
+    location.row = new_row;
 }
 
-std::vector<Name> World::getComponentList(Entity entity) const
+void World::removeEntityFromArchetype(Entity entity)
 {
-    std::vector<Name> list{};
-    for (uint32_t i = 0; i < static_cast<uint32_t>(m_component_arrays.size()); ++i) {
-        if (m_entity_signatures[entity].hasComponentIndex(i)) {
-            list.push_back(m_component_names[i]);
+    EntityLocation& location = m_entity_locations[entity];
+    GC_ASSERT(location.archetype != ARCHETYPE_NONE);
+
+    const Entity moved_entity = m_archetypes[location.archetype]->removeRow(location.row);
+    if (moved_entity != ENTITY_NONE) {
+        m_entity_locations[moved_entity].row = location.row;
+    }
+
+    location.archetype = ARCHETYPE_NONE;
+    location.row = 0;
+}
+
+const World::QueryState& World::getOrCreateQueryState(const Signature& required)
+{
+    GC_ASSERT(m_iteration_depth == 0 && "Cannot create queries while iterating!");
+
+    if (auto it = m_query_lookup.find(required); it != m_query_lookup.end()) {
+        return *m_queries[it->second];
+    }
+
+    auto state = std::make_unique<QueryState>(required, std::vector<Archetype*>{});
+    for (const auto& archetype : m_archetypes) {
+        if (archetype->getSignature().contains(required)) {
+            state->archetypes.push_back(archetype.get());
         }
     }
-    return list;
+
+    m_query_lookup.emplace(required, static_cast<uint32_t>(m_queries.size()));
+    m_queries.push_back(std::move(state));
+    return *m_queries.back();
 }
 
 } // namespace gc
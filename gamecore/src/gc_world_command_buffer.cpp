@@ -0,0 +1,110 @@
+#include "gamecore/gc_world_command_buffer.h"
+
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include "gclog/gclog.h"
+
+namespace gc {
+
+Entity WorldCommandBuffer::createEntity(Name name, Entity parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    GC_ASSERT(m_creates.size() <= PENDING_INDEX_MASK && "Too many entities created in one command buffer");
+    const auto pending_entity = PENDING_ENTITY_BIT | (m_buffer_id << PENDING_BUFFER_ID_SHIFT) | static_cast<Entity>(m_creates.size());
+    m_creates.emplace_back(name, parent, position, rotation, scale);
+    return pending_entity;
+}
+
+Entity WorldCommandBuffer::resolve(Entity entity) const
+{
+    if (entity != ENTITY_NONE && (entity & PENDING_ENTITY_BIT)) {
+        GC_ASSERT((entity & PENDING_BUFFER_ID_MASK) >> PENDING_BUFFER_ID_SHIFT == m_buffer_id && "Placeholder entity from another command buffer");
+        const Entity pending_index = entity & PENDING_INDEX_MASK;
+        GC_ASSERT(pending_index < m_created_entities.size() && "Placeholder entity used before it was created");
+        return m_created_entities[pending_index];
+    }
+    return entity;
+}
+
+void WorldCommandBuffer::applyCreates(World& world)
+{
+    if (m_creates.empty()) {
+        return;
+    }
+
+    m_created_entities.reserve(m_creates.size());
+    world.reserveEntities(static_cast<uint32_t>(m_creates.size()));
+    for (const CreateCommand& command : m_creates) {
+        m_created_entities.push_back(world.createEntity(command.name, resolve(command.parent), command.position, command.rotation, command.scale));
+    }
+}
+
+void WorldCommandBuffer::applyComponentCommands(World& world, std::vector<ComponentCommand>& commands, bool add)
+{
+    // Grouping by component means each ComponentArray is only grown once
+    std::ranges::stable_sort(commands, {}, &ComponentCommand::component_index);
+    for (auto group_begin = commands.begin(); group_begin != commands.end();) {
+        const uint32_t component_index = group_begin->component_index;
+        const auto group_end = std::find_if(group_begin, commands.end(), [&](const ComponentCommand& c) { return c.component_index != component_index; });
+
+        if (add) {
+            Entity highest_entity = 0;
+            for (auto it = group_begin; it != group_end; ++it) {
+                it->entity = resolve(it->entity);
+                highest_entity = std::max(highest_entity, it->entity);
+            }
+            world.reserveComponents(component_index, static_cast<uint32_t>(group_end - group_begin), highest_entity);
+        }
+
+        for (auto it = group_begin; it != group_end; ++it) {
+            const Entity entity = resolve(it->entity);
+            if (world.isAlive(entity)) {
+                it->func(world, entity, m_component_data.data() + it->data_offset);
+            }
+            else {
+                GC_TRACE("Skipping component command for deleted entity {}", entity);
+            }
+        }
+
+        group_begin = group_end;
+    }
+}
+
+void WorldCommandBuffer::applyDeletes(World& world)
+{
+    for (Entity entity : m_deletes) {
+        entity = resolve(entity);
+        // deleting a parent also deletes its children so they may already be gone
+        if (world.isAlive(entity)) {
+            world.deleteEntity(entity);
+        }
+    }
+}
+
+void WorldCommandBuffer::apply(World& world)
+{
+    if (empty()) {
+        return;
+    }
+
+    ZoneScoped;
+
+    applyCreates(world);
+    applyAdds(world);
+    applyRemoves(world);
+    applyDeletes(world);
+    clear();
+}
+
+void WorldCommandBuffer::clear()
+{
+    m_creates.clear();
+    m_adds.clear();
+    m_removes.clear();
+    m_deletes.clear();
+    m_component_data.clear();
+    m_created_entities.clear();
+}
+
+} // namespace gc
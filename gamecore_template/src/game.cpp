@@ -1,5 +1,6 @@
 #include "game.h"
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <random>
@@ -31,6 +32,7 @@
 #include <gamecore/gc_transform_system.h>
 #include <gamecore/gc_window.h>
 #include <gamecore/gc_world.h>
+#include <gamecore/gc_world_command_buffer.h>
 #include <gamecore/gc_gen_mesh.h>
 #include <gamecore/gc_net.h>
 #include <gamecore/gc_byte_reader.h>
@@ -39,14 +41,13 @@
 #include "mouse_move.h"
 #include "spin.h"
 
-static gc::Entity createRemotePlayer(gc::World& world, gc::Name name)
+static void createRemotePlayer(gc::WorldCommandBuffer& commands, gc::Name name, const glm::vec3& position, const glm::quat& rotation)
 {
     constexpr float CAMERA_HEIGHT = 67.5f * 25.4e-3f;
-    const auto player = world.createEntity(name, gc::ENTITY_NONE);
-    const auto player_model = world.createEntity(gc::Name("player_model"), player, {0.0f, 0.0f, -CAMERA_HEIGHT});
-    world.getComponent<gc::TransformComponent>(player_model)->setScale(0.360f);
-    world.addComponent<gc::RenderableComponent>(player_model).setMaterial(gc::Name()).setMesh(gc::Name("shrek.obj"));
-    return player;
+    const auto player = commands.createEntity(name, gc::ENTITY_NONE, position, rotation);
+    const auto player_model =
+        commands.createEntity(gc::Name("player_model"), player, {0.0f, 0.0f, -CAMERA_HEIGHT}, glm::quat{1.0f, 0.0f, 0.0f, 0.0f}, glm::vec3{0.360f});
+    commands.addComponent(player_model, gc::RenderableComponent{}.setMaterial(gc::Name()).setMesh(gc::Name("shrek.obj")));
 }
 
 static float extractYaw(const glm::quat& rotation)
@@ -85,6 +86,8 @@ public:
 
     void onUpdate([[maybe_unused]] gc::FrameState& frame_state) override
     {
+        // Players created this frame don't exist until the command buffer is applied after this system
+        std::vector<gc::Name> created_players{};
         for (const auto& net_ev : frame_state.net_events) {
             if (net_ev.type == gc::Name("player_snapshot")) {
                 gc::ByteReader reader(net_ev.data);
@@ -97,12 +100,15 @@ public:
                     const float pos_y = reader.readF32();
                     const float pos_z = reader.readF32();
                     const float yaw = reader.readF32();
-                    gc::Entity player = m_world.findEntity(player_name);
-                    if (player == gc::ENTITY_NONE) {
-                        player = createRemotePlayer(m_world, player_name);
+                    const gc::Entity player = m_world.findEntity(player_name);
+                    if (player != gc::ENTITY_NONE) {
+                        m_world.getComponent<gc::TransformComponent>(player)->setPosition(pos_x, pos_y, pos_z);
+                        m_world.getComponent<gc::TransformComponent>(player)->setRotation(yawToQuaternion(yaw));
+                    }
+                    else if (std::ranges::find(created_players, player_name) == created_players.end()) {
+                        createRemotePlayer(m_world.commands(), player_name, glm::vec3{pos_x, pos_y, pos_z}, yawToQuaternion(yaw));
+                        created_players.push_back(player_name);
                     }
-                    m_world.getComponent<gc::TransformComponent>(player)->setPosition(pos_x, pos_y, pos_z);
-                    m_world.getComponent<gc::TransformComponent>(player)->setRotation(yawToQuaternion(yaw));
                 }
             }
         }
@@ -131,38 +137,39 @@ public:
     {
         if (m_net.getMode() == gc::NetMode::DISCONNECTED) return;
 
-        m_world.forEach<gc::TransformComponent, ReplicatablePlayerComponent>([&](gc::Entity, const gc::TransformComponent& t, ReplicatablePlayerComponent& p) {
-            const uint32_t name = t.name.getHash();
-            const glm::vec3 pos = t.getPosition();
-            const float yaw = extractYaw(t.getRotation());
-
-            constexpr float MIN_DISTANCE_CHANGE = 0.05f; // meters
-            constexpr float MIN_YAW_CHANGE = 0.01f;      // radians
-
-            if (glm::distance(p.old_pos, pos) > MIN_DISTANCE_CHANGE || fabsf(p.old_yaw - yaw) > MIN_YAW_CHANGE) {
-                gc::NetEvent ev{};
-                ev.type = gc::Name("player_snapshot");
-                ev.data.resize(sizeof(uint32_t)   // player_name
-                               + sizeof(uint16_t) // seq_num
-                               + sizeof(float)    // pos_x
-                               + sizeof(float)    // pos_y
-                               + sizeof(float)    // pos_z
-                               + sizeof(float));  // yaw
-                gc::ByteWriter writer(ev.data);
-                writer.writeU32(name);
-                writer.writeU16(p.seq_num);
-                writer.writeF32(pos.x);
-                writer.writeF32(pos.y);
-                writer.writeF32(pos.z);
-                writer.writeF32(yaw);
-
-                m_net.postEvent(ev);
-                ++p.seq_num;
-
-                p.old_pos = pos;
-                p.old_yaw = yaw;
-            }
-        });
+        m_world.forEach<const gc::TransformComponent, ReplicatablePlayerComponent>(
+            [&](gc::Entity, const gc::TransformComponent& t, ReplicatablePlayerComponent& p) {
+                const uint32_t name = t.getName().getHash();
+                const glm::vec3 pos = t.getPosition();
+                const float yaw = extractYaw(t.getRotation());
+
+                constexpr float MIN_DISTANCE_CHANGE = 0.05f; // meters
+                constexpr float MIN_YAW_CHANGE = 0.01f;      // radians
+
+                if (glm::distance(p.old_pos, pos) > MIN_DISTANCE_CHANGE || fabsf(p.old_yaw - yaw) > MIN_YAW_CHANGE) {
+                    gc::NetEvent ev{};
+                    ev.type = gc::Name("player_snapshot");
+                    ev.data.resize(sizeof(uint32_t)   // player_name
+                                   + sizeof(uint16_t) // seq_num
+                                   + sizeof(float)    // pos_x
+                                   + sizeof(float)    // pos_y
+                                   + sizeof(float)    // pos_z
+                                   + sizeof(float));  // yaw
+                    gc::ByteWriter writer(ev.data);
+                    writer.writeU32(name);
+                    writer.writeU16(p.seq_num);
+                    writer.writeF32(pos.x);
+                    writer.writeF32(pos.y);
+                    writer.writeF32(pos.z);
+                    writer.writeF32(yaw);
+
+                    m_net.postEvent(ev);
+                    ++p.seq_num;
+
+                    p.old_pos = pos;
+                    p.old_yaw = yaw;
+                }
+            });
     }
 };
 
@@ -217,14 +224,18 @@ public:
             world.registerComponent<gc::CameraComponent, gc::ComponentArrayType::SPARSE>();
             world.registerComponent<gc::LightComponent, gc::ComponentArrayType::SPARSE>();
             world.registerSystem<gc::RenderSystem>(resource_manager, render_backend);
-            world.registerSystem<gc::CameraSystem>();
-            world.registerSystem<gc::LightSystem>();
+            world.registerSystemWithAccess<gc::CameraSystem>(
+                gc::SystemAccess{}.reads<gc::TransformComponent, gc::CameraComponent>().exclusive(gc::DRAW_DATA_CAMERA_RESOURCE));
+            world.registerSystemWithAccess<gc::LightSystem>(
+                gc::SystemAccess{}.reads<gc::TransformComponent, gc::LightComponent>().exclusive(gc::DRAW_DATA_LIGHT_RESOURCE));
 
             // register game systems and components
             world.registerComponent<SpinComponent, gc::ComponentArrayType::SPARSE>();
             world.registerComponent<MouseMoveComponent, gc::ComponentArrayType::SPARSE>();
             world.registerComponent<ReplicatablePlayerComponent, gc::ComponentArrayType::SPARSE>();
-            world.registerSystem<SpinSystem>();
+            // SpinSystem writes TransformComponent, which CameraSystem, LightSystem and TransformSystem read, so it always gets a stage to itself.
+            // Its parallelForEach() is safe to run from a worker so it isn't tied to the main thread.
+            world.registerSystemWithAccess<SpinSystem>(gc::SystemAccess{}.writes<gc::TransformComponent, SpinComponent>());
             world.registerSystem<MouseMoveSystem>();
             world.registerSystem<ReplicatedPlayerSystem>();
             world.registerSystem<ReplicatablePlayerSystem>(app.net());
@@ -386,6 +386,10 @@ void EditorSystem::onUpdate(FrameState& frame_state)
             resetPreviewEntity();
         }
 
+        // Fetched every frame as component pointers can be invalidated and getComponent() marks the components as changed
+        m_preview_transform = m_world.getComponent<TransformComponent>(m_preview_entity);
+        m_preview_renderable = m_world.getComponent<RenderableComponent>(m_preview_entity);
+
         if (m_preview_mesh.empty()) {
             m_preview_mesh = m_resource_manager.add<ResourceMesh>(genCubeMesh());
         }
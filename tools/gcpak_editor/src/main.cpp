@@ -63,8 +63,9 @@ static void initEditorWorld(gc::App& app, const std::filesystem::path& open_file
     world.registerComponent<gc::LightComponent, gc::ComponentArrayType::SPARSE>();
 
     world.registerSystem<gc::RenderSystem>(resource_manager, render_backend);
-    world.registerSystem<gc::CameraSystem>();
-    world.registerSystem<gc::LightSystem>();
+    world.registerSystemWithAccess<gc::CameraSystem>(
+        gc::SystemAccess{}.reads<gc::TransformComponent, gc::CameraComponent>().exclusive(gc::DRAW_DATA_CAMERA_RESOURCE));
+    world.registerSystemWithAccess<gc::LightSystem>(gc::SystemAccess{}.reads<gc::TransformComponent, gc::LightComponent>().exclusive(gc::DRAW_DATA_LIGHT_RESOURCE));
 
     world.registerSystem<EditorSystem>(window, resource_manager, open_file);
 
@@ -0,0 +1,252 @@
+//
+// transform_benchmark.exe
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <gamecore/gc_transform_math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define TRANSFORM_BENCHMARK_SSE
+#endif
+
+static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+// The members of TransformComponent that are read and written when its world matrix is updated, in the same order
+struct Transform {
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 scale;
+    uint32_t parent_index; // parents come before their children
+    glm::mat4 world_matrix;
+};
+
+// The same transforms with one array per member, so 4 transforms' members can be loaded into SSE registers directly
+struct TransformsSoA {
+    std::vector<float> position_x, position_y, position_z;
+    std::vector<float> rotation_x, rotation_y, rotation_z, rotation_w;
+    std::vector<float> scale_x, scale_y, scale_z;
+    std::vector<uint32_t> parent_index;
+    std::vector<glm::mat4> world_matrix;
+};
+
+// Groups of 8 transforms, each a root with a binary tree of descendants 3 levels deep, in depth-first order like TransformSystem's hierarchy
+static std::vector<Transform> createTransforms(uint32_t count)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    std::vector<Transform> transforms(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        Transform& t = transforms[i];
+        t.position = glm::vec3(dist(rng), dist(rng), dist(rng)) * 10.0f;
+        t.rotation = glm::normalize(glm::quat(dist(rng), dist(rng), dist(rng), dist(rng)));
+        t.scale = glm::vec3(1.0f) + glm::vec3(dist(rng), dist(rng), dist(rng)) * 0.5f;
+        const uint32_t group_index = i % 8;
+        t.parent_index = (group_index == 0) ? NO_PARENT : i - group_index + (group_index - 1) / 2;
+        t.world_matrix = glm::mat4{1.0f};
+    }
+    return transforms;
+}
+
+static TransformsSoA createTransformsSoA(const std::vector<Transform>& transforms)
+{
+    TransformsSoA soa{};
+    for (const Transform& t : transforms) {
+        soa.position_x.push_back(t.position.x);
+        soa.position_y.push_back(t.position.y);
+        soa.position_z.push_back(t.position.z);
+        soa.rotation_x.push_back(t.rotation.x);
+        soa.rotation_y.push_back(t.rotation.y);
+        soa.rotation_z.push_back(t.rotation.z);
+        soa.rotation_w.push_back(t.rotation.w);
+        soa.scale_x.push_back(t.scale.x);
+        soa.scale_y.push_back(t.scale.y);
+        soa.scale_z.push_back(t.scale.z);
+        soa.parent_index.push_back(t.parent_index);
+        soa.world_matrix.push_back(t.world_matrix);
+    }
+    return soa;
+}
+
+// What TransformSystem did before: build the rotation matrix, set the translation, scale it, then a full 4x4 multiply with the parent
+static void updateOld(std::vector<Transform>& transforms)
+{
+    for (Transform& t : transforms) {
+        glm::mat4 local_matrix = glm::mat4_cast(t.rotation);
+        local_matrix[3][0] = t.position.x;
+        local_matrix[3][1] = t.position.y;
+        local_matrix[3][2] = t.position.z;
+        local_matrix = glm::scale(local_matrix, t.scale);
+        const glm::mat4 parent_matrix = (t.parent_index == NO_PARENT) ? glm::mat4{1.0f} : transforms[t.parent_index].world_matrix;
+        t.world_matrix = parent_matrix * local_matrix;
+    }
+}
+
+// What TransformSystem::updateWorldMatrices() does for each dirty node
+static void updateNew(std::vector<Transform>& transforms)
+{
+    for (Transform& t : transforms) {
+        const glm::mat4 local_matrix = gc::composeTransform(t.position, t.rotation, t.scale);
+        if (t.parent_index == NO_PARENT) {
+            t.world_matrix = local_matrix;
+        }
+        else {
+            t.world_matrix = gc::multiplyAffine(transforms[t.parent_index].world_matrix, local_matrix);
+        }
+    }
+}
+
+// Composes local matrices 4 at a time from the SoA arrays, then applies the parents of those 4 while their matrices are still in cache.
+// Parents always come first, so a parent in the same group of 4 is already done.
+static void updateSoA(TransformsSoA& soa)
+{
+    const std::size_t count = soa.parent_index.size();
+    std::size_t i = 0;
+
+#ifdef TRANSFORM_BENCHMARK_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    for (; i + 4 <= count; i += 4) {
+        const __m128 qx = _mm_loadu_ps(&soa.rotation_x[i]);
+        const __m128 qy = _mm_loadu_ps(&soa.rotation_y[i]);
+        const __m128 qz = _mm_loadu_ps(&soa.rotation_z[i]);
+        const __m128 qw = _mm_loadu_ps(&soa.rotation_w[i]);
+        const __m128 sx = _mm_loadu_ps(&soa.scale_x[i]);
+        const __m128 sy = _mm_loadu_ps(&soa.scale_y[i]);
+        const __m128 sz = _mm_loadu_ps(&soa.scale_z[i]);
+
+        const __m128 x2 = _mm_mul_ps(qx, two);
+        const __m128 y2 = _mm_mul_ps(qy, two);
+        const __m128 z2 = _mm_mul_ps(qz, two);
+        const __m128 xx = _mm_mul_ps(qx, x2);
+        const __m128 yy = _mm_mul_ps(qy, y2);
+        const __m128 zz = _mm_mul_ps(qz, z2);
+        const __m128 xy = _mm_mul_ps(qx, y2);
+        const __m128 xz = _mm_mul_ps(qx, z2);
+        const __m128 yz = _mm_mul_ps(qy, z2);
+        const __m128 wx = _mm_mul_ps(qw, x2);
+        const __m128 wy = _mm_mul_ps(qw, y2);
+        const __m128 wz = _mm_mul_ps(qw, z2);
+
+        // one register per matrix element across the 4 transforms, same formulas as gc::composeTransform()
+        __m128 m00 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+        __m128 m01 = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+        __m128 m02 = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+        __m128 m03 = zero;
+        __m128 m10 = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+        __m128 m11 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+        __m128 m12 = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+        __m128 m13 = zero;
+        __m128 m20 = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+        __m128 m21 = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+        __m128 m22 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+        __m128 m23 = zero;
+        __m128 m30 = _mm_loadu_ps(&soa.position_x[i]);
+        __m128 m31 = _mm_loadu_ps(&soa.position_y[i]);
+        __m128 m32 = _mm_loadu_ps(&soa.position_z[i]);
+        __m128 m33 = one;
+
+        // afterwards each register holds one column of one transform's matrix
+        _MM_TRANSPOSE4_PS(m00, m01, m02, m03);
+        _MM_TRANSPOSE4_PS(m10, m11, m12, m13);
+        _MM_TRANSPOSE4_PS(m20, m21, m22, m23);
+        _MM_TRANSPOSE4_PS(m30, m31, m32, m33);
+        const __m128 columns[4][4] = {{m00, m10, m20, m30}, {m01, m11, m21, m31}, {m02, m12, m22, m32}, {m03, m13, m23, m33}};
+        for (std::size_t lane = 0; lane < 4; ++lane) {
+            glm::mat4& m = soa.world_matrix[i + lane];
+            for (int column = 0; column < 4; ++column) {
+                _mm_storeu_ps(&m[column].x, columns[lane][column]);
+            }
+            if (soa.parent_index[i + lane] != NO_PARENT) {
+                m = gc::multiplyAffine(soa.world_matrix[soa.parent_index[i + lane]], m);
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const glm::mat4 local_matrix =
+            gc::composeTransform(glm::vec3(soa.position_x[i], soa.position_y[i], soa.position_z[i]),
+                                 glm::quat(soa.rotation_w[i], soa.rotation_x[i], soa.rotation_y[i], soa.rotation_z[i]),
+                                 glm::vec3(soa.scale_x[i], soa.scale_y[i], soa.scale_z[i]));
+        if (soa.parent_index[i] == NO_PARENT) {
+            soa.world_matrix[i] = local_matrix;
+        }
+        else {
+            soa.world_matrix[i] = gc::multiplyAffine(soa.world_matrix[soa.parent_index[i]], local_matrix);
+        }
+    }
+}
+
+static float maxError(const glm::mat4& a, const glm::mat4& b)
+{
+    float max_error = 0.0f;
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            max_error = std::max(max_error, std::abs(a[column][row] - b[column][row]));
+        }
+    }
+    return max_error;
+}
+
+// Returns the fastest of several runs in nanoseconds per transform
+template <typename Transforms, typename Func>
+static double timeUpdate(Transforms& transforms, uint32_t count, Func&& update)
+{
+    // Around 20 million transforms per measurement, but at least 5 runs
+    const uint32_t runs = std::max(5u, 20'000'000 / count);
+    double best = std::numeric_limits<double>::max();
+    for (uint32_t run = 0; run < runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        update(transforms);
+        const std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+        best = std::min(best, duration.count());
+    }
+    return best / static_cast<double>(count);
+}
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+    std::cout << std::format("{:>10} {:>14} {:>14} {:>14} {:>8} {:>8} {:>10}\n", "transforms", "old (ns each)", "new (ns each)", "SoA (ns each)",
+                             "new", "SoA", "max error");
+
+    for (const uint32_t count : {10'000u, 100'000u, 1'000'000u}) {
+        std::vector<Transform> old_transforms = createTransforms(count);
+        std::vector<Transform> new_transforms = old_transforms;
+        TransformsSoA soa_transforms = createTransformsSoA(old_transforms);
+
+        const double old_time = timeUpdate(old_transforms, count, updateOld);
+        const double new_time = timeUpdate(new_transforms, count, updateNew);
+        const double soa_time = timeUpdate(soa_transforms, count, updateSoA);
+
+        // all paths must give the same world matrices
+        float max_error = 0.0f;
+        for (uint32_t i = 0; i < count; ++i) {
+            max_error = std::max(max_error, maxError(old_transforms[i].world_matrix, new_transforms[i].world_matrix));
+            max_error = std::max(max_error, maxError(old_transforms[i].world_matrix, soa_transforms.world_matrix[i]));
+        }
+
+        std::cout << std::format("{:>10} {:>14.2f} {:>14.2f} {:>14.2f} {:>7.2f}x {:>7.2f}x {:>10.2e}\n", count, old_time, new_time, soa_time,
+                                 old_time / new_time, old_time / soa_time, max_error);
+    }
+
+    return EXIT_SUCCESS;
+}